@@ -1,957 +1,751 @@
 #include <SFML/Graphics.hpp>
+#include "GameEngine.h"
+#include "AllocTracker.h"
+#include "Catalog.h"
+#include "NetPlay.h"
+#include "Spectator.h"
+#include "Replay.h"
+#include "ResourceManager.h"
+#include "Snapshot.h"
+#include "SpriteAtlas.h"
+#include "TextBatch.h"
+#include "Undo.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <random>
 #include <string>
 #include <iostream>
 
-// Game constants based on assignment
-const int gridSize = 5;
 const int cellSize = 100;
-const int pathLen = 13;
-const int coinCount = 8;
-const int hurdleCount = 5;
-
-// Point values from assignment
-const int GOLD_COIN_POINTS = 10;
-const int SILVER_COIN_POINTS = 5;
-
-// Item costs
-const int SWORD_COST = 40;
-const int SHIELD_COST = 30;
-const int WATER_COST = 50;
-const int KEY_COST = 70;
-
-// Hurdle costs
-const int FIRE_COST = 50;
-const int SNAKE_COST = 30;
-const int GHOST_COST = 20;
-const int LION_COST = 50;    // Only with gold coins
-const int LOCK_COST = 60;    // Only with silver coins
-
-// Initial money
-const int INITIAL_GOLD = 20;
-const int INITIAL_SILVER = 40;
-
-enum CoinType { GOLD, SILVER };
-enum HurdleType { FIRE, SNAKE, GHOST, LION, LOCK };
-enum GameMode { MOVE_MODE, BUY_MODE, PLACE_HURDLE_MODE };
 
-// Base class for all game items
-class GameObject {
-public:
-    int x, y;
-    bool active;
+// Score panels sit two to a row under the board
+const int panelRows = (playerCount + 1) / 2;
+const int panelRowHeight = 45;
+const int hudHeight = 150 + (panelRows - 1) * panelRowHeight;
 
-    GameObject() : x(0), y(0), active(true) {}
-    GameObject(int xPos, int yPos) : x(xPos), y(yPos), active(true) {}
+enum GameMode { MOVE_MODE, BUY_MODE, PLACE_HURDLE_MODE };
 
-    virtual void interact() {}
-    virtual ~GameObject() {}
+// What to do about frames that touch the heap (needs -DAQ_TRACK_ALLOCATIONS)
+enum AllocCheck {
+    ALLOC_IGNORE,
+    ALLOC_REPORT,   // print every frame that allocated
+    ALLOC_FAIL      // also exit with an error once past the warm-up frames
 };
 
-// Derived class for coins
-class Coin : public GameObject {
-public:
-    CoinType type;
-    bool collected;
+// The first frames may still create driver-side buffers
+const int allocWarmupFrames = 2;
+
+// How often a network game looks for the other machine's input
+const sf::Time netPollInterval = sf::milliseconds(10);
+
+// Everything main() sets up from the command line
+struct GameOptions {
+    uint64_t seed;
+    unsigned frameLimit;            // 0 = no cap; frames are only drawn on demand anyway
+    AllocCheck allocCheck;
+    ReplayRecorder* recorder;       // logs every accepted input, or null
+    const ReplayFile* replay;       // plays this back instead of taking input, or null
+    const GameState* resume;        // starts from this position instead of a new board, or null
+    const char* savePath;           // where F5 saves and F9 restores
+    int undoSteps;                  // how far Ctrl+Z reaches back
+    NetHost* host;                  // hosts a network game for one remote player, or null
+    NetClient* client;              // plays one seat of a network game held by another machine, or null
+    SpectatorFeed* feed;            // shows the board to viewers, or null
+};
 
-    Coin() : GameObject(), type(GOLD), collected(false) {}
-    Coin(int xPos, int yPos, CoinType coinType) : GameObject(xPos, yPos), type(coinType), collected(false) {}
+// How the shop marks a price that needs one kind of coin, by Currency
+static const char* const priceTags[] = { "", "-Gold", "-Silver" };
+static const char* const placeNotes[] = { "", " - Gold only", " - Silver only" };
+static const char* const hurdleLabels[hurdleTypeCount] = { "FIRE", "SNAKE", "GHOST", "LION", "LOCK" };
 
-    void interact() override {
-        collected = true;
-        active = false;
-    }
+// What happens to a player caught by each HurdleType; the penalty itself
+// comes from the rules
+static const char* const hurdleHitLines[hurdleTypeCount] = {
+    "got burned", "was bitten by the snake", "was scared by the ghost", "was attacked by the lion", "is locked in"
 };
 
-// Derived class for hurdles
-class Hurdle : public GameObject {
-public:
-    HurdleType type;
-    bool triggered;
+// How each seat is drawn; the first two are the original red and blue
+struct SeatColors {
+    sf::Color token;
+    sf::Color path;         // cells on the player's path
+    sf::Color panel;        // score panel background
+    sf::Color inventory;    // inventory line
+    sf::Color banner;       // "Player N Wins!"
+};
+
+static const SeatColors seatColors[maxBoardPlayers] = {
+    { sf::Color(255, 50, 50), sf::Color(255, 150, 150), sf::Color(255, 200, 200, 150), sf::Color(100, 0, 0), sf::Color(255, 100, 100) },
+    { sf::Color(100, 100, 255), sf::Color(150, 150, 255), sf::Color(200, 200, 250, 150), sf::Color(0, 0, 100), sf::Color(100, 100, 255) },
+    { sf::Color(50, 170, 50), sf::Color(160, 220, 160), sf::Color(200, 240, 200, 150), sf::Color(0, 90, 0), sf::Color(100, 220, 100) },
+    { sf::Color(255, 150, 0), sf::Color(255, 210, 150), sf::Color(255, 230, 190, 150), sf::Color(120, 60, 0), sf::Color(255, 180, 80) },
+    { sf::Color(170, 80, 220), sf::Color(215, 170, 240), sf::Color(230, 210, 245, 150), sf::Color(70, 0, 110), sf::Color(200, 140, 255) },
+    { sf::Color(0, 160, 160), sf::Color(150, 215, 215), sf::Color(195, 235, 235, 150), sf::Color(0, 80, 80), sf::Color(80, 220, 220) },
+    { sf::Color(230, 80, 160), sf::Color(245, 175, 215), sf::Color(250, 210, 230, 150), sf::Color(110, 0, 60), sf::Color(255, 130, 200) },
+    { sf::Color(140, 95, 50), sf::Color(205, 175, 140), sf::Color(225, 205, 185, 150), sf::Color(70, 40, 10), sf::Color(200, 150, 100) }
+};
+
+// Player moved by a number key (1 moves player 1, ...), or -1
+static int playerForKey(sf::Keyboard::Key key) {
+    if (key >= sf::Keyboard::Num1 && key < sf::Keyboard::Num1 + playerCount) return key - sf::Keyboard::Num1;
+    if (key >= sf::Keyboard::Numpad1 && key < sf::Keyboard::Numpad1 + playerCount) return key - sf::Keyboard::Numpad1;
+    return -1;
+}
 
-    Hurdle() : GameObject(), type(FIRE), triggered(false) {}
-    Hurdle(int xPos, int yPos, HurdleType hurdleType) : GameObject(xPos, yPos), type(hurdleType), triggered(false) {}
+// Character sizes the HUD uses, in the order handed to GlyphAtlas::build
+enum HudFace { FACE_STATUS, FACE_TITLE, FACE_SCORE, FACE_INVENTORY, FACE_BANNER };
 
-    void interact() override {
-        triggered = true;
+// Last values a HUD block was formatted from, so text is only rebuilt
+// when one of them changes
+class HudBinding {
+public:
+    HudBinding() : count(0) {}
+
+    template <typename... Values>
+    bool update(Values... current) {
+        const int values[] = { static_cast<int>(current)... };
+        const int n = sizeof...(current);
+        if (count == n && std::equal(values, values + n, last)) return false;
+        std::copy(values, values + n, last);
+        count = n;
+        return true;
     }
+
+private:
+    int last[8];
+    int count;
 };
 
+// Appends an axis-aligned rectangle as two triangles
+static void appendRect(sf::VertexArray& vertices, float x, float y, float w, float h, sf::Color color) {
+    vertices.append(sf::Vertex(sf::Vector2f(x, y), color));
+    vertices.append(sf::Vertex(sf::Vector2f(x + w, y), color));
+    vertices.append(sf::Vertex(sf::Vector2f(x + w, y + h), color));
+    vertices.append(sf::Vertex(sf::Vector2f(x, y), color));
+    vertices.append(sf::Vertex(sf::Vector2f(x + w, y + h), color));
+    vertices.append(sf::Vertex(sf::Vector2f(x, y + h), color));
+}
+
+// Window-side view of a player: colours, labels and key debouncing.
+// The rules themselves live in PlayerState (GameEngine.h).
 class Player {
 public:
-    int path[pathLen][2];
-    int pos;
     sf::Color color;
-    int goldCoins, silverCoins;
-    int score;
-    int skipTurns;
-    int sword, shield, water, key;
     bool canMove;
     std::string name;
-    bool atGoal;
     char symbol;
 
-    Player(bool isP1, sf::Color col) : pos(0), color(col), skipTurns(0), sword(1), shield(1),
-        water(1), key(1), canMove(true), atGoal(false),
-        goldCoins(INITIAL_GOLD), silverCoins(INITIAL_SILVER), score(0) {
-        name = isP1 ? "Player 1" : "Player 2";
-        symbol = isP1 ? '1' : '2';
-
-        int idx = 0;
-        if (isP1) {
-            // Player 1 path - kept the same as your original code
-            for (int c = 4; c >= 0; c--) path[idx][0] = c, path[idx++][1] = 0;
-            path[idx][0] = 0; path[idx++][1] = 1;
-            for (int c = 1; c <= 4; c++) path[idx][0] = c, path[idx++][1] = 1;
-            path[idx][0] = 4; path[idx++][1] = 2;
-            path[idx][0] = 3; path[idx++][1] = 2;
-            path[idx][0] = 2; path[idx++][1] = 2;
-        }
-        else {
-            // Player 2 path - kept the same as your original code
-            for (int c = 0; c <= 4; c++) path[idx][0] = c, path[idx++][1] = 4;
-            path[idx][0] = 4; path[idx++][1] = 3;
-            for (int c = 3; c >= 0; c--) path[idx][0] = c, path[idx++][1] = 3;
-            path[idx][0] = 0; path[idx++][1] = 2;
-            path[idx][0] = 1; path[idx++][1] = 2;
-            path[idx][0] = 2; path[idx++][1] = 2;
-        }
+    Player() : Player(0) {}
+
+    explicit Player(int index) : color(seatColors[index].token), canMove(true) {
+        name = "Player " + std::to_string(index + 1);
+        symbol = static_cast<char>('1' + index);
     }
+};
 
-    void move() {
-        if (!canMove) return;
+class Game {
+private:
+    sf::RenderWindow window;
+    GameState state;
+    Player players[playerCount];
+    ResourceCache<sf::Font>::Handle font;
+    sf::Clock moveClock;
+    const float moveDelay = 0.1f; // 100ms delay between moves
+    unsigned frameLimit;          // 0 = no cap; frames are only drawn on demand anyway
+    char statusMessage[160];      // fixed buffer so status updates never allocate
+    sf::Clock statusClock;
+    GameMode currentMode;
+    HurdleType selectedHurdleType;
+    bool placingHurdle;
 
-        if (skipTurns > 0) {
-            skipTurns--;
-            return;
-        }
+    // Visual feedback elements
+    sf::RectangleShape overlay;
+
+    // Static board background, rebuilt only when the layout or window changes
+    sf::VertexArray boardVertices;
+    bool boardDirty;
+
+    // Board tokens, pre-rendered once the font is available
+    SpriteAtlas atlas;
+    SpriteBatch sprites;
+
+    // HUD text, laid out from a glyph atlas and drawn in one call
+    GlyphAtlas glyphs;
+    TextBatch hud;
+    int scoreText[playerCount], inventoryText[playerCount];
+    int shopTitleText, instructionsText, statusText, gameOverText;
+    HudBinding scoreBindings[playerCount], inventoryBindings[playerCount];
+    HudBinding shopBinding, gameOverBinding;
+
+    // Heap allocations charged to the frame being prepared
+    AllocCheck allocCheck;
+    unsigned long long frameAllocations;
+    int framesDrawn;
+
+    // Match recording and playback (Replay.h)
+    ReplayRecorder* recorder;
+    const ReplayFile* replay;
+    int replayTurn;
+
+    // Quick save (Snapshot.h)
+    const char* savePath;
+
+    // Undo, redo and previews (Undo.h). While previewing, an action is
+    // only tried out until Enter keeps it or Escape takes it back.
+    UndoHistory history;
+    bool previewing;
+    bool previewPending;
+    ReplayRecord previewRecord;
+    int previewPlayer;      // who was selected before the tried action
+
+    // Network play (NetPlay.h). The host's state is the real one; a
+    // client's is a copy kept up to date from the host.
+    NetHost* host;
+    NetClient* client;
+    bool peerJoined;
+    SpectatorFeed* feed;
 
-        if (pos + 1 < pathLen) {
-            pos++;
-            canMove = false; // Player must release key before moving again
+public:
+    explicit Game(const GameOptions& options) : window(sf::VideoMode(gridSize* cellSize, gridSize* cellSize + hudHeight), "Adventure Quest"),
+        frameLimit(options.frameLimit), currentMode(MOVE_MODE), placingHurdle(false), boardVertices(sf::Triangles), boardDirty(true),
+        sprites(atlas), hud(glyphs), allocCheck(options.allocCheck), frameAllocations(0), framesDrawn(0),
+        recorder(options.recorder), replay(options.replay), replayTurn(0), savePath(options.savePath),
+        history(options.undoSteps), previewing(false), previewPending(false), previewRecord(), previewPlayer(0),
+        host(options.host), client(options.client), peerJoined(options.client != nullptr), feed(options.feed) {
+        statusMessage[0] = '\0';
+        for (int p = 0; p < playerCount; p++) {
+            players[p] = Player(p);
+        }
 
-            // Check if player has reached the goal
-            if (path[pos][0] == 2 && path[pos][1] == 2) {
-                atGoal = true;
-            }
+        if (replay) {
+            seekReplay(*replay, 0, state);
+            std::cout << "Replaying " << replay->turnCount() << " turns on board seed " << options.seed
+                << ": Left/Right step a turn, PageUp/PageDown jump " << replayKeyframeInterval << ", Home/End go to either end" << std::endl;
         }
-    }
+        else if (client) {
+            state = *options.resume;
+            shopAsOwnSeat();
+            if (client->seat() == netEverySeat) std::cout << "Joined a room playing every seat";
+            else if (watching()) std::cout << "Watching a match";
+            else std::cout << "Joined as Player " << client->seat() + 1;
+            std::cout << " on board seed " << state.seed << std::endl;
+        }
+        else if (options.resume) {
+            state = *options.resume;
+            std::cout << "Resuming a saved match on board seed " << state.seed << std::endl;
+        }
+        else {
+            newGame(state, options.seed);
+            std::cout << "Board seed: " << options.seed << " (replay this board with --seed " << options.seed << ")" << std::endl;
+        }
+        history.reset(state);
+        if (feed) feed->publish(state);
+
+        // Fonts load in the background while run() shows the loading screen
+        ResourceManager::instance().fonts.preload("arial.ttf");
 
-    sf::Vector2i getPosition() {
-        return { path[pos][0], path[pos][1] };
+        // Game over overlay
+        overlay.setSize(sf::Vector2f(gridSize * cellSize, gridSize * cellSize));
+        overlay.setFillColor(sf::Color(0, 0, 0, 150)); // Semi-transparent black
     }
 
-    void collectCoin(Coin& coin) {
-        if (coin.collected) return;
-        sf::Vector2i p = getPosition();
-        if (p.x == coin.x && p.y == coin.y) {
-            coin.collected = true;
-            if (coin.type == GOLD) {
-                goldCoins++;
-                score += GOLD_COIN_POINTS;
-            }
-            else {
-                silverCoins++;
-                score += SILVER_COIN_POINTS;
-            }
-            std::cout << name << " collected a " << (coin.type == GOLD ? "gold" : "silver") << " coin!" << std::endl;
+    static sf::Color cellColor(int x, int y) {
+        int cell = cellIndex(x, y);
+        // Special coloring for the goal cell
+        if (cell == Board::goalCell)
+            return sf::Color(255, 215, 0); // Gold color for the goal
+        // Player paths, starts included; where paths cross the lower seat shows
+        for (int p = 0; p < playerCount; p++) {
+            if (Board::pathStep(p, cell) >= 0)
+                return seatColors[p].path;
         }
+        return sf::Color(240, 240, 240); // Off-white for other cells
     }
-    bool buyItem(const std::string& itemType) {
-        int totalValue = goldCoins * GOLD_COIN_POINTS + silverCoins * SILVER_COIN_POINTS;
-
-        if (itemType == "sword") {
-            if (totalValue < SWORD_COST) return false;  // Not enough coins
-
-            score -= SWORD_COST;
-            // Deduct from coins (prefer silver first to preserve gold)
-            int costRemaining = SWORD_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            sword++;
-            return true;
-        }
-        else if (itemType == "shield") {
-            if (totalValue < SHIELD_COST) return false;  // Not enough coins
-
-            score -= SHIELD_COST;
-            // Similar deduction logic
-            int costRemaining = SHIELD_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            shield++;
-            return true;
-        }
-        else if (itemType == "water") {
-            if (totalValue < WATER_COST) return false;  // Not enough coins
-
-            score -= WATER_COST;
-            // Similar deduction logic
-            int costRemaining = WATER_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            water++;
-            return true;
-        }
-        else if (itemType == "key") {
-            if (totalValue < KEY_COST) return false;  // Not enough coins
-
-            score -= KEY_COST;
-            // Similar deduction logic
-            int costRemaining = KEY_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            key++;
-            return true;
-        }
 
-        return false;
+    // Where player p's score text starts
+    static float panelLeft(int p) {
+        return p % 2 * gridSize * cellSize / 2.0f + 10;
     }
-    bool buyHurdle(const std::string& hurdleType) {
-        if (hurdleType == "fire") {
-            if (goldCoins * GOLD_COIN_POINTS + silverCoins * SILVER_COIN_POINTS < FIRE_COST)
-                return false;  // Not enough coins
-
-            score -= FIRE_COST;
-            // Deduct from coins
-            int costRemaining = FIRE_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            return true;
-        }
-        else if (hurdleType == "snake") {
-            if (goldCoins * GOLD_COIN_POINTS + silverCoins * SILVER_COIN_POINTS < SNAKE_COST)
-                return false;  // Not enough coins
-
-            score -= SNAKE_COST;
-            // Similar deduction logic
-            int costRemaining = SNAKE_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
-            }
-            return true;
-        }
-        else if (hurdleType == "ghost") {
-            if (goldCoins * GOLD_COIN_POINTS + silverCoins * SILVER_COIN_POINTS < GHOST_COST)
-                return false;  // Not enough coins
-
-            score -= GHOST_COST;
-            // Similar deduction logic
-            int costRemaining = GHOST_COST;
-            int silverValue = silverCoins * SILVER_COIN_POINTS;
-            if (silverValue >= costRemaining) {
-                silverCoins -= costRemaining / SILVER_COIN_POINTS;
-                if (costRemaining % SILVER_COIN_POINTS > 0) silverCoins--;
-            }
-            else {
-                costRemaining -= silverValue;
-                silverCoins = 0;
-                goldCoins -= costRemaining / GOLD_COIN_POINTS;
-                if (costRemaining % GOLD_COIN_POINTS > 0) goldCoins--;
+    static float panelTop(int p) {
+        return static_cast<float>(gridSize * cellSize + 10 + p / 2 * panelRowHeight);
+    }
+
+    // Top of the shop panel, below the last row of score panels
+    static float shopTop() {
+        return static_cast<float>(gridSize * cellSize + 5 + panelRows * panelRowHeight);
+    }
+
+    // Bakes every cell, grid line and HUD panel into boardVertices
+    void buildBoard() {
+        boardVertices.clear();
+
+        for (int y = 0; y < gridSize; y++) {
+            for (int x = 0; x < gridSize; x++) {
+                appendRect(boardVertices, x * cellSize + 1, y * cellSize + 1, cellSize - 2, cellSize - 2, cellColor(x, y));
             }
-            return true;
         }
-        else if (hurdleType == "lion") {
-            if (goldCoins < LION_COST / GOLD_COIN_POINTS)
-                return false;  // Not enough gold coins
 
-            // Lion can only be bought with gold
-            score -= LION_COST;
-            goldCoins -= LION_COST / GOLD_COIN_POINTS;
-            return true;
+        // Path grid lines for better visibility
+        for (int i = 0; i <= gridSize; i++) {
+            appendRect(boardVertices, 0, i * cellSize, gridSize * cellSize, 1, sf::Color(100, 100, 100));
+            appendRect(boardVertices, i * cellSize, 0, 1, gridSize * cellSize, sf::Color(100, 100, 100));
         }
-        else if (hurdleType == "lock") {
-            if (silverCoins < LOCK_COST / SILVER_COIN_POINTS)
-                return false;  // Not enough silver coins
 
-            // Lock can only be bought with silver
-            score -= LOCK_COST;
-            silverCoins -= LOCK_COST / SILVER_COIN_POINTS;
-            return true;
+        // Player info boxes, two to a row
+        for (int p = 0; p < playerCount; p++) {
+            appendRect(boardVertices, panelLeft(p) - 5, panelTop(p) - 5, gridSize * cellSize / 2 - 10, 40, seatColors[p].panel);
         }
 
-        return false;
-    }
+        // Shop panel
+        appendRect(boardVertices, 0, shopTop(), gridSize * cellSize, 50, sf::Color(200, 200, 200, 150));
 
-    void handleHurdle(Hurdle& h) {
-        if (h.triggered) return;
-        sf::Vector2i p = getPosition();
-        if (p.x == h.x && p.y == h.y) {
-            switch (h.type) {
-            case FIRE:
-                if (water > 0) {
-                    water--;
-                    std::cout << name << " used water to extinguish fire!" << std::endl;
-                }
-                else {
-                    skipTurns = 2;
-                    std::cout << name << " got burned! Skip 2 turns." << std::endl;
-                }
-                break;
-            case SNAKE:
-                if (sword > 0) {
-                    sword--;
-                    std::cout << name << " used sword to defeat snake!" << std::endl;
-                }
-                else {
-                    skipTurns = 3;
-                    if (pos >= 3) pos -= 3;
-                    std::cout << name << " was bitten by snake! Move back 3 spaces and skip 3 turns." << std::endl;
-                }
-                break;
-            case GHOST:
-                if (shield > 0) {
-                    shield--;
-                    std::cout << name << " used shield against ghost!" << std::endl;
-                }
-                else {
-                    skipTurns = 1;
-                    std::cout << name << " was scared by ghost! Skip 1 turn." << std::endl;
-                }
-                break;
-            case LION:
-                if (sword > 0) {
-                    sword--;
-                    std::cout << name << " used sword to defeat lion!" << std::endl;
-                }
-                else {
-                    skipTurns = 4;
-                    std::cout << name << " was attacked by lion! Skip 4 turns." << std::endl;
-                }
-                break;
-            case LOCK:
-                if (key > 0) {
-                    key--;
-                    std::cout << name << " used key to unlock!" << std::endl;
-                }
-                else {
-                    skipTurns = 5; 
-                    std::cout << name << " is locked! have to wait for 5 turns ." << std::endl;
-                }
-                break;
-            }
-            h.triggered = true;
-        }
+        boardDirty = false;
     }
 
-    int getScore() {
-        return score;
+    void drawGrid() {
+        if (boardDirty) {
+            buildBoard();
+        }
+        window.draw(boardVertices);
     }
 
-    void draw(sf::RenderWindow& window) {
-        sf::CircleShape playerShape(cellSize / 3);
-        playerShape.setFillColor(color);
-        playerShape.setPosition(path[pos][0] * cellSize + cellSize / 3, path[pos][1] * cellSize + cellSize / 3);
-        window.draw(playerShape);
-
-        // Draw player symbol (P1 or P2)
-        sf::Text playerText;
-        sf::Font font;
-        if (font.loadFromFile("arial.ttf")) {
-            playerText.setFont(font);
-            playerText.setString("P" + std::string(1, symbol));
-            playerText.setCharacterSize(20);
-            playerText.setFillColor(sf::Color::White);
-            playerText.setPosition(path[pos][0] * cellSize + cellSize / 2 - 10,
-                path[pos][1] * cellSize + cellSize / 2 - 10);
-            window.draw(playerText);
-        }
-
-        // Draw skip turns indicator if needed
-        if (skipTurns > 0) {
-            sf::Text skipText;
-            if (font.loadFromFile("arial.ttf")) {
-                skipText.setFont(font);
-                skipText.setString(std::to_string(skipTurns));
-                skipText.setCharacterSize(16);
-                skipText.setFillColor(sf::Color::White);
-                skipText.setPosition(path[pos][0] * cellSize + cellSize / 2 + 10,
-                    path[pos][1] * cellSize + cellSize / 2 - 10);
-                window.draw(skipText);
+    // Points the sprite slots at the current board; slots only touch their
+    // vertices when the entity they show has changed
+    void syncSprites() {
+        const EntityTable<entityCapacity>& coins = state.coins;
+        for (int i = 0; i < entityCapacity; i++) {
+            if (i >= coins.end() || !coins.isLive(i)) {
+                sprites.hide(i);
+                continue;
             }
+            sprites.show(i, coins.type[i] == GOLD ? SPRITE_GOLD_COIN : SPRITE_SILVER_COIN,
+                sf::Vector2f(coins.cell[i] % gridSize * cellSize + cellSize / 3, coins.cell[i] / gridSize * cellSize + cellSize / 3));
         }
-    }
-};
-
-class Game {
-private:
-    sf::RenderWindow window;
-    Player p1, p2;
-    Coin coins[coinCount];
-    Hurdle hurdles[hurdleCount];
-    bool gameOver;
-    sf::Font font;
-    sf::Clock moveClock;
-    const float moveDelay = 0.1f; // 100ms delay between moves
-    sf::Text statusText;
-    std::string statusMessage;
-    sf::Clock statusClock;
-    GameMode currentMode;
-    int currentPlayer; // 1 for P1, 2 for P2
-    HurdleType selectedHurdleType;
-    bool placingHurdle;
 
-    // Visual feedback elements
-    sf::RectangleShape p1InfoBox;
-    sf::RectangleShape p2InfoBox;
-    sf::RectangleShape shopPanel;
-    sf::RectangleShape actionPanel;
-
-public:
-    Game() : window(sf::VideoMode(gridSize* cellSize, gridSize* cellSize + 150), "Adventure Quest"),
-        p1(true, sf::Color(255, 50, 50)), p2(false, sf::Color(100, 100, 255)),
-        gameOver(false), currentMode(MOVE_MODE), currentPlayer(1),
-        placingHurdle(false) {
-
-        std::srand(static_cast<unsigned>(std::time(0)));
-        if (!font.loadFromFile("arial.ttf")) {
-            std::cerr << "Error loading font!" << std::endl;
+        const EntityTable<entityCapacity>& hurdles = state.hurdles;
+        for (int i = 0; i < entityCapacity; i++) {
+            int slot = entityCapacity + i;
+            if (i >= hurdles.end() || !hurdles.isLive(i)) {
+                sprites.hide(slot);
+                continue;
+            }
+            sprites.show(slot, static_cast<SpriteId>(SPRITE_FIRE + hurdles.type[i]),
+                sf::Vector2f(hurdles.cell[i] % gridSize * cellSize + cellSize / 3, hurdles.cell[i] / gridSize * cellSize + cellSize / 3));
         }
 
-        // Initialize status text
-        statusText.setFont(font);
-        statusText.setCharacterSize(16);
-        statusText.setFillColor(sf::Color::Red);
-        statusText.setPosition(10, gridSize * cellSize + 100);
+        for (int p = 0; p < playerCount; p++) {
+            const PlayerState& player = state.players[p];
+            Cell cell = player.getPosition();
+            int slot = entityCapacity * 2 + p * 2;
+            sprites.show(slot, static_cast<SpriteId>(SPRITE_PLAYER1 + p),
+                sf::Vector2f(cell.x * cellSize + cellSize / 3, cell.y * cellSize + cellSize / 3));
+
+            // Skip turns indicator
+            if (player.skipTurns > 0) {
+                sprites.show(slot + 1, static_cast<SpriteId>(SPRITE_SKIP1 + std::min(player.skipTurns, 5) - 1),
+                    sf::Vector2f(cell.x * cellSize + cellSize / 2 + 10, cell.y * cellSize + cellSize / 2 - 10));
+            }
+            else {
+                sprites.hide(slot + 1);
+            }
+        }
+    }
 
-        // Initialize player info boxes
-        p1InfoBox.setSize(sf::Vector2f(gridSize * cellSize / 2 - 10, 40));
-        p1InfoBox.setPosition(5, gridSize * cellSize + 5);
-        p1InfoBox.setFillColor(sf::Color(255, 200, 200, 150)); // Light red background
+    // Coins, hurdles and player tokens in one draw call
+    void drawEntities() {
+        syncSprites();
+        window.draw(sprites);
+    }
 
-        p2InfoBox.setSize(sf::Vector2f(gridSize * cellSize / 2 - 10, 40));
-        p2InfoBox.setPosition(gridSize * cellSize / 2 + 5, gridSize * cellSize + 5);
-        p2InfoBox.setFillColor(sf::Color(200, 200, 250, 150)); // Light blue background
+    // Creates the HUD text blocks once the glyph atlas exists
+    void setupHud() {
+        const FontFace faces[] = {
+            { 16, false },  // FACE_STATUS
+            { 14, false },  // FACE_TITLE
+            { 12, false },  // FACE_SCORE
+            { 10, false },  // FACE_INVENTORY
+            { 40, true }    // FACE_BANNER
+        };
+        glyphs.build(*font, faces, sizeof(faces) / sizeof(faces[0]));
+
+        for (int p = 0; p < playerCount; p++) {
+            scoreText[p] = hud.addBlock(FACE_SCORE, sf::Color::Black, sf::Vector2f(panelLeft(p), panelTop(p)), 64);
+            inventoryText[p] = hud.addBlock(FACE_INVENTORY, seatColors[p].inventory, sf::Vector2f(panelLeft(p), panelTop(p) + 15), 64);
+        }
+        shopTitleText = hud.addBlock(FACE_TITLE, sf::Color::Black, sf::Vector2f(10, shopTop() + 5), 64);
+        instructionsText = hud.addBlock(FACE_SCORE, sf::Color(80, 80, 80), sf::Vector2f(gridSize * cellSize - 240, shopTop() + 30), 48);
+        statusText = hud.addBlock(FACE_STATUS, sf::Color::Red, sf::Vector2f(10, shopTop() + 50), 128);
+        gameOverText = hud.addBlock(FACE_BANNER, sf::Color::White,
+            sf::Vector2f(gridSize * cellSize / 2.0f, gridSize * cellSize / 2.0f), 16, TextBatch::ALIGN_CENTER);
 
-        // Shop panel
-        shopPanel.setSize(sf::Vector2f(gridSize * cellSize, 50));
-        shopPanel.setPosition(0, gridSize * cellSize + 50);
-        shopPanel.setFillColor(sf::Color(200, 200, 200, 150));
-
-        // Initialize coins with random positions, avoiding player start positions
-        for (int i = 0; i < coinCount; i++) {
-            bool validPosition = false;
-            while (!validPosition) {
-                coins[i].x = std::rand() % gridSize;
-                coins[i].y = std::rand() % gridSize;
-
-                // Avoid placing coins on player start positions or goal (2,2)
-                if ((coins[i].x == 4 && coins[i].y == 0) || // P1 start
-                    (coins[i].x == 0 && coins[i].y == 4) || // P2 start
-                    (coins[i].x == 2 && coins[i].y == 2)) { // Goal
-                    continue;
-                }
+        hud.setText(statusText, statusMessage);
+    }
 
-                // Check if position already has a coin
-                validPosition = true;
-                for (int j = 0; j < i; j++) {
-                    if (coins[j].x == coins[i].x && coins[j].y == coins[i].y) {
-                        validPosition = false;
-                        break;
-                    }
-                }
-            }
+    void updateScores(int player, int scoreBlock, HudBinding& scoreBinding, int inventoryBlock, HudBinding& inventoryBinding) {
+        const PlayerState& s = state.players[player];
+        char line[96];
 
-            coins[i].type = i < 4 ? GOLD : SILVER;
-            coins[i].collected = false;
+        if (scoreBinding.update(s.score, s.goldCoins, s.silverCoins)) {
+            std::snprintf(line, sizeof(line), "%s: Score %d | Gold %d | Silver %d",
+                playerView(player).name.c_str(), s.score, s.goldCoins, s.silverCoins);
+            hud.setText(scoreBlock, line);
+        }
+        if (inventoryBinding.update(s.items[SWORD], s.items[SHIELD], s.items[WATER], s.items[KEY])) {
+            std::snprintf(line, sizeof(line), "Sword: %d | Shield: %d | Water: %d | Key: %d",
+                s.items[SWORD], s.items[SHIELD], s.items[WATER], s.items[KEY]);
+            hud.setText(inventoryBlock, line);
         }
+    }
 
-        // Initialize hurdles with random positions, avoiding coins, player start positions and goal
-        for (int i = 0; i < hurdleCount; i++) {
-            bool validPosition = false;
-            while (!validPosition) {
-                hurdles[i].x = std::rand() % gridSize;
-                hurdles[i].y = std::rand() % gridSize;
+    void updateShop() {
+        if (!shopBinding.update(currentMode, selectedHurdleType, previewing, previewPending)) return;
 
-                // Avoid placing hurdles on player start positions or goal
-                if ((hurdles[i].x == 4 && hurdles[i].y == 0) || // P1 start
-                    (hurdles[i].x == 0 && hurdles[i].y == 4) || // P2 start
-                    (hurdles[i].x == 2 && hurdles[i].y == 2)) { // Goal
-                    continue;
-                }
+        if (currentMode == BUY_MODE) {
+            hud.setText(shopTitleText, "SHOP - Press [H]elping Objects or [B]lockages");
+        }
+        else if (currentMode == PLACE_HURDLE_MODE) {
+            const HurdleRule& rule = rules().hurdles[selectedHurdleType];
+            char hurdleText[64];
+            std::snprintf(hurdleText, sizeof(hurdleText), "Place %s (%dpts%s) - Click on grid",
+                hurdleLabels[selectedHurdleType], rule.cost, placeNotes[rule.currency]);
+            hud.setText(shopTitleText, hurdleText);
+        }
+        else {
+            hud.setText(shopTitleText, "Press [B] to buy items or [M] to move");
+        }
 
-                // Check if position already has a coin or hurdle
-                validPosition = true;
-                for (int c = 0; c < coinCount; c++) {
-                    if (coins[c].x == hurdles[i].x && coins[c].y == hurdles[i].y) {
-                        validPosition = false;
-                        break;
-                    }
-                }
+        if (previewPending) {
+            hud.setText(instructionsText, "[Enter] keeps it, [Esc] takes it back");
+        }
+        else if (currentMode == MOVE_MODE) {
+            char instructions[48];
+            std::snprintf(instructions, sizeof(instructions), previewing ? "Preview: 1-%d to try a move, [B] to buy" :
+                "Press 1-%d to move, [B] to buy", playerCount);
+            hud.setText(instructionsText, instructions);
+        }
+        else if (currentMode == BUY_MODE) {
+            hud.setText(instructionsText, "Press 1-5 for items, [Esc] to cancel");
+        }
+        else {
+            hud.setText(instructionsText, "Click grid to place, [Esc] to cancel");
+        }
+    }
 
-                if (!validPosition) continue;
+    void updateGameStatus() {
+        // Status message fades after five seconds
+        hud.setVisible(statusText, statusMessage[0] != '\0' && statusClock.getElapsedTime().asSeconds() < 5.0f);
 
-                for (int h = 0; h < i; h++) {
-                    if (hurdles[h].x == hurdles[i].x && hurdles[h].y == hurdles[i].y) {
-                        validPosition = false;
-                        break;
-                    }
-                }
-            }
+        int winnerIndex = winner(state);
+        if (!gameOverBinding.update(state.gameOver, winnerIndex)) return;
 
-            hurdles[i].type = static_cast<HurdleType>(std::rand() % 5);
-            hurdles[i].triggered = false;
+        hud.setVisible(gameOverText, state.gameOver);
+        if (winnerIndex >= 0) {
+            char banner[32];
+            std::snprintf(banner, sizeof(banner), "Player %d Wins!", winnerIndex + 1);
+            hud.setText(gameOverText, banner);
+            hud.setColor(gameOverText, seatColors[winnerIndex].banner);
+        }
+        else {
+            hud.setText(gameOverText, "It's a Tie!");
+            hud.setColor(gameOverText, sf::Color::White);
         }
     }
 
-    void drawGrid() {
-        for (int y = 0; y < gridSize; y++) {
-            for (int x = 0; x < gridSize; x++) {
-                sf::RectangleShape cell(sf::Vector2f(cellSize - 2, cellSize - 2));
-                cell.setPosition(x * cellSize + 1, y * cellSize + 1);
-
-                // Special coloring for the goal cell
-                if (x == 2 && y == 2)
-                    cell.setFillColor(sf::Color(255, 215, 0)); // Gold color for the goal
-                // Player 1 path - alternate colors for clarity
-                else if ((y == 0 || y == 1 || (y == 2 && (x == 4 || x == 3))) &&
-                    !((x == 0 && y == 4) || (x == 2 && y == 2)))
-                    cell.setFillColor(sf::Color(255, 150, 150)); // Very light red for P1 path
-                // Player 2 path - alternate colors for clarity
-                else if ((y == 4 || y == 3 || (y == 2 && (x == 0 || x == 1))) &&
-                    !((x == 4 && y == 0) || (x == 2 && y == 2)))
-                    cell.setFillColor(sf::Color(150, 150, 255)); // Very light blue for P2 path
-                // Special coloring for player starting positions
-                else if (x == 4 && y == 0) // P1 start
-                    cell.setFillColor(sf::Color(255, 200, 200)); // Light red for P1 start
-                else if (x == 0 && y == 4) // P2 start
-                    cell.setFillColor(sf::Color(200, 200, 255)); // Light blue for P2 start
-                else
-                    cell.setFillColor(sf::Color(240, 240, 240)); // Off-white for other cells
-
-                window.draw(cell);
-            }
+    void drawHud() {
+        for (int p = 0; p < playerCount; p++) {
+            updateScores(p, scoreText[p], scoreBindings[p], inventoryText[p], inventoryBindings[p]);
         }
+        updateShop();
+        updateGameStatus();
 
-        // Draw path grid lines for better visibility
-        for (int i = 0; i <= gridSize; i++) {
-            sf::RectangleShape horizontalLine(sf::Vector2f(gridSize * cellSize, 1));
-            horizontalLine.setPosition(0, i * cellSize);
-            horizontalLine.setFillColor(sf::Color(100, 100, 100));
-            window.draw(horizontalLine);
-
-            sf::RectangleShape verticalLine(sf::Vector2f(1, gridSize * cellSize));
-            verticalLine.setPosition(i * cellSize, 0);
-            verticalLine.setFillColor(sf::Color(100, 100, 100));
-            window.draw(verticalLine);
+        if (state.gameOver) {
+            window.draw(overlay);
         }
+        window.draw(hud);
     }
 
-    void drawCoins() {
-        for (int i = 0; i < coinCount; i++) {
-            if (coins[i].collected) continue;
-
-            sf::CircleShape coinShape(cellSize / 5);
-            coinShape.setPosition(coins[i].x * cellSize + cellSize / 3, coins[i].y * cellSize + cellSize / 3);
-
-            if (coins[i].type == GOLD) {
-                coinShape.setFillColor(sf::Color(255, 215, 0)); // Gold color
-
-                // Draw $ symbol inside gold coin
-                sf::Text symbol;
-                symbol.setFont(font);
-                symbol.setString("$");
-                symbol.setCharacterSize(22);
-                symbol.setFillColor(sf::Color(150, 150, 0));
-                symbol.setPosition(coins[i].x * cellSize + cellSize / 2 - 6,
-                    coins[i].y * cellSize + cellSize / 2 - 12);
-                window.draw(coinShape);
-                window.draw(symbol);
-            }
-            else {
-                coinShape.setFillColor(sf::Color(192, 192, 192)); // Silver color
-
-                // Draw ¢ symbol inside silver coin
-                sf::Text symbol;
-                symbol.setFont(font);
-                symbol.setString("¢");
-                symbol.setCharacterSize(22);
-                symbol.setFillColor(sf::Color(100, 100, 100));
-                symbol.setPosition(coins[i].x * cellSize + cellSize / 2 - 6,
-                    coins[i].y * cellSize + cellSize / 2 - 12);
-                window.draw(coinShape);
-                window.draw(symbol);
-            }
-        }
+    // printf-style, formatted straight into the status buffer
+    void setStatusMessage(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(statusMessage, sizeof(statusMessage), format, args);
+        va_end(args);
+        statusClock.restart();
+        hud.setText(statusText, statusMessage);
+    }
+        
+    Player& playerView(int index) {
+        return players[index];
     }
 
-    void drawHurdles() {
-        for (int i = 0; i < hurdleCount; i++) {
-            if (hurdles[i].triggered) continue;
-
-            sf::CircleShape hurdle(cellSize / 5);
-            hurdle.setPosition(hurdles[i].x * cellSize + cellSize / 3, hurdles[i].y * cellSize + cellSize / 3);
-
-            // Different colors & symbols for different hurdle types
-            sf::Text symbol;
-            symbol.setFont(font);
-            symbol.setCharacterSize(22);
+    // Echoes what the engine did to the console, as the game always has
+    void reportEvents(const StepResult& result) {
+        for (int i = 0; i < result.eventCount; i++) {
+            const GameEvent& e = result.events[i];
+            const std::string& name = playerView(e.player).name;
 
-            switch (hurdles[i].type) {
-            case FIRE:
-                hurdle.setFillColor(sf::Color(255, 80, 80));
-                symbol.setString("F");
-                symbol.setFillColor(sf::Color(255, 255, 150));
+            switch (e.type) {
+            case EVENT_COIN_COLLECTED:
+                std::cout << name << " collected a " << (e.detail == GOLD ? "gold" : "silver") << " coin!" << std::endl;
                 break;
-            case SNAKE:
-                hurdle.setFillColor(sf::Color(100, 180, 100));
-                symbol.setString("S");
-                symbol.setFillColor(sf::Color(50, 100, 50));
+            case EVENT_HURDLE_BLOCKED:
+                std::cout << name << " used a " << itemNames[rules().hurdles[e.detail].counter] << " against the "
+                    << hurdleNames[e.detail] << "!" << std::endl;
                 break;
-            case GHOST:
-                hurdle.setFillColor(sf::Color(200, 200, 255));
-                symbol.setString("G");
-                symbol.setFillColor(sf::Color(100, 100, 200));
+            case EVENT_HURDLE_HIT:
+                std::cout << name << " " << hurdleHitLines[e.detail] << "!";
+                reportPenalty(rules().hurdles[e.detail]);
+                std::cout << std::endl;
                 break;
-            case LION:
-                hurdle.setFillColor(sf::Color(255, 180, 100));
-                symbol.setString("L");
-                symbol.setFillColor(sf::Color(200, 100, 0));
-                break;
-            case LOCK:
-                hurdle.setFillColor(sf::Color(200, 100, 200));
-                symbol.setString("X");
-                symbol.setFillColor(sf::Color(150, 0, 150));
+            default:
                 break;
             }
-
-            symbol.setPosition(hurdles[i].x * cellSize + cellSize / 2 - 6,
-                hurdles[i].y * cellSize + cellSize / 2 - 12);
-            window.draw(hurdle);
-            window.draw(symbol);
         }
     }
 
-    void drawShop() {
-        window.draw(shopPanel);
-
-        // Draw shop title
-        sf::Text shopTitle;
-        shopTitle.setFont(font);
-        shopTitle.setCharacterSize(14);
-        shopTitle.setFillColor(sf::Color::Black);
-        shopTitle.setPosition(10, gridSize * cellSize + 55);
-
-        if (currentMode == BUY_MODE) {
-            shopTitle.setString("SHOP - Press [H]elping Objects or [B]lockages");
+    // The penalty as the engine applies it (PlayerState::handleHurdle)
+    static void reportPenalty(const HurdleRule& rule) {
+        if (rule.pushback > 0) {
+            std::cout << " Move back " << rule.pushback << (rule.pushback == 1 ? " space" : " spaces");
+            std::cout << (rule.skipTurns > 0 ? " and skip " : ".");
         }
-        else if (currentMode == PLACE_HURDLE_MODE) {
-            std::string hurdleText;
-            switch (selectedHurdleType) {
-            case FIRE: hurdleText = "FIRE (50pts)"; break;
-            case SNAKE: hurdleText = "SNAKE (30pts)"; break;
-            case GHOST: hurdleText = "GHOST (20pts)"; break;
-            case LION: hurdleText = "LION (50pts - Gold only)"; break;
-            case LOCK: hurdleText = "LOCK (60pts - Silver only)"; break;
-            }
-            shopTitle.setString("Place " + hurdleText + " - Click on grid");
+        else if (rule.skipTurns > 0) {
+            std::cout << " Skip ";
         }
-        else {
-            shopTitle.setString("Press [B] to buy items or [M] to move");
+        if (rule.skipTurns > 0) {
+            std::cout << rule.skipTurns << (rule.skipTurns == 1 ? " turn." : " turns.");
         }
+    }
 
-        window.draw(shopTitle);
+    // step(). Accepted actions become an undo step and are logged when
+    // recording, unless previewing holds them back.
+    StepResult play(const Action& action) {
+        if (client) return askHost(action);
 
-        // Draw instructions
-        sf::Text instructions;
-        instructions.setFont(font);
-        instructions.setCharacterSize(12);
-        instructions.setFillColor(sf::Color(80, 80, 80));
-        instructions.setPosition(gridSize * cellSize - 240, gridSize * cellSize + 80);
+        int selected = state.currentPlayer;
+        StepResult result = step(state, action);
+        if (!result.ok()) return result;
 
-        if (currentMode == MOVE_MODE) {
-            instructions.setString("Press 1 for P1, 2 for P2, [B] to buy");
-        }
-        else if (currentMode == BUY_MODE) {
-            instructions.setString("Press 1-5 for items, [Esc] to cancel");
+        if (previewing) {
+            previewPending = true;
+            previewRecord = ReplayRecord::of(action);
+            previewPlayer = selected;
         }
         else {
-            instructions.setString("Click grid to place, [Esc] to cancel");
+            keep(ReplayRecord::of(action));
         }
-
-        window.draw(instructions);
+        return result;
     }
 
-    void drawScores() {
-        // Draw info boxes
-        window.draw(p1InfoBox);
-        window.draw(p2InfoBox);
-
-        // Draw player 1 score and inventory
-        sf::Text p1Text;
-        p1Text.setFont(font);
-        p1Text.setCharacterSize(12);
-        p1Text.setFillColor(sf::Color::Black);
-        p1Text.setPosition(10, gridSize * cellSize + 10);
-        p1Text.setString(p1.name + ": Score " + std::to_string(p1.getScore()) +
-            " | Gold " + std::to_string(p1.goldCoins) +
-            " | Silver " + std::to_string(p1.silverCoins));
-        window.draw(p1Text);
-
-        // Draw player 1 inventory
-        sf::Text p1Inventory;
-        p1Inventory.setFont(font);
-        p1Inventory.setCharacterSize(10);
-        p1Inventory.setFillColor(sf::Color(100, 0, 0));
-        p1Inventory.setPosition(10, gridSize * cellSize + 25);
-        p1Inventory.setString("Sword: " + std::to_string(p1.sword) +
-            " | Shield: " + std::to_string(p1.shield) +
-            " | Water: " + std::to_string(p1.water) +
-            " | Key: " + std::to_string(p1.key));
-        window.draw(p1Inventory);
-
-        // Draw player 2 score and inventory
-        sf::Text p2Text;
-        p2Text.setFont(font);
-        p2Text.setCharacterSize(12);
-        p2Text.setFillColor(sf::Color::Black);
-        p2Text.setPosition(gridSize * cellSize / 2 + 10, gridSize * cellSize + 10);
-        p2Text.setString(p2.name + ": Score " + std::to_string(p2.getScore()) +
-            " | Gold " + std::to_string(p2.goldCoins) +
-            " | Silver " + std::to_string(p2.silverCoins));
-        window.draw(p2Text);
-
-        // Draw player 2 inventory
-        sf::Text p2Inventory;
-        p2Inventory.setFont(font);
-        p2Inventory.setCharacterSize(10);
-        p2Inventory.setFillColor(sf::Color(0, 0, 100));
-        p2Inventory.setPosition(gridSize * cellSize / 2 + 10, gridSize * cellSize + 25);
-        p2Inventory.setString("Sword: " + std::to_string(p2.sword) +
-            " | Shield: " + std::to_string(p2.shield) +
-            " | Water: " + std::to_string(p2.water) +
-            " | Key: " + std::to_string(p2.key));
-        window.draw(p2Inventory);
-
-       
+    void keep(ReplayRecord input) {
+        if (recorder) recorder->record(input, state);
+        history.record(state);
+        if (host) host->publish(state);
     }
 
-    void drawGameStatus() {
-        // Draw status message
-        if (!statusMessage.empty() && statusClock.getElapsedTime().asSeconds() < 5.0f) {
-            statusText.setString(statusMessage);
-            window.draw(statusText);
+    // A client's play(): sends the action and waits briefly for the host
+    // to apply or refuse it. The client always shops as its own seat.
+    StepResult askHost(const Action& action) {
+        StepResult result;
+        if (!client->send(action)) {
+            result.error = STEP_BAD_ACTION;
+            return result;
         }
+        sf::Clock waited;
+        while (waited.getElapsedTime() < sf::seconds(1.0f)) {
+            NetUpdate update = client->poll(state);
+            if (update == NET_STATE) {
+                shopAsOwnSeat();
+                break;
+            }
+            if (update == NET_REJECTED || update == NET_DISCONNECTED) {
+                result.error = update == NET_REJECTED ? client->rejection() : STEP_BAD_ACTION;
+                break;
+            }
+            client->waitForInput(10);
+        }
+        return result;
+    }
 
-        // Draw game result if game is over
-        if (gameOver) {
-            sf::RectangleShape overlay(sf::Vector2f(gridSize * cellSize, gridSize * cellSize));
-            overlay.setFillColor(sf::Color(0, 0, 0, 150)); // Semi-transparent black
-            window.draw(overlay);
+    // Seats the other machine plays
+    bool remoteSeat(int player) const {
+        return (host && player == host->seat()) || (client && client->seat() != netEverySeat && player != client->seat());
+    }
 
-            sf::Text gameOverText;
-            gameOverText.setFont(font);
-            gameOverText.setCharacterSize(40);
-            gameOverText.setStyle(sf::Text::Bold);
-            gameOverText.setFillColor(sf::Color::White);
-
-            if (p1.atGoal && p2.atGoal) {
-                // Both reached goal, compare scores
-                if (p1.getScore() > p2.getScore()) {
-                    gameOverText.setString("Player 1 Wins!");
-                    gameOverText.setFillColor(sf::Color(255, 100, 100));
-                }
-                else if (p2.getScore() > p1.getScore()) {
-                    gameOverText.setString("Player 2 Wins!");
-                    gameOverText.setFillColor(sf::Color(100, 100, 255));
-                }
-                else {
-                    gameOverText.setString("It's a Tie!");
-                    gameOverText.setFillColor(sf::Color::White);
-                }
-            }
-            else if (p1.atGoal) {
-                gameOverText.setString("Player 1 Wins!");
-                gameOverText.setFillColor(sf::Color(255, 100, 100));
+    // A client pays in the shop as its own seat, whoever moved last
+    void shopAsOwnSeat() {
+        if (client->seat() < playerCount) state.currentPlayer = client->seat();
+    }
+
+    // Joined to a spectator feed, which takes no input
+    bool watching() const {
+        return client && client->seat() == netSpectatorSeat;
+    }
+
+    // Takes in whatever the other machine sent; true if the board changed
+    bool pollNetwork() {
+        bool changed = false;
+        if (host) {
+            Action action;
+            while (host->poll(state, action)) {
+                // The remote player's moves do not change who shops here
+                int selected = state.currentPlayer;
+                StepResult result = play(action);
+                if (!result.ok()) host->reject(result.error);
+                reportEvents(result);
+                selectPlayer(selected);
+                changed = true;
             }
-            else if (p2.atGoal) {
-                gameOverText.setString("Player 2 Wins!");
-                gameOverText.setFillColor(sf::Color(100, 100, 255));
+        }
+        else if (client && peerJoined) {
+            NetUpdate update;
+            while ((update = client->poll(state)) != NET_IDLE) {
+                if (update == NET_DISCONNECTED) {
+                    std::cerr << "Disconnected: " << client->error() << std::endl;
+                    setStatusMessage("Disconnected from the host");
+                    break;
+                }
+                if (update == NET_REJECTED) setStatusMessage("The host refused that");
+                shopAsOwnSeat();
+                changed = true;
             }
+        }
 
-            // Center the text
-            sf::FloatRect textRect = gameOverText.getLocalBounds();
-            gameOverText.setOrigin(textRect.left + textRect.width / 2.0f,
-                textRect.top + textRect.height / 2.0f);
-            gameOverText.setPosition(sf::Vector2f(gridSize * cellSize / 2.0f, gridSize * cellSize / 2.0f));
-            window.draw(gameOverText);
-
-            // Restart instructions
-            sf::Text restartText;
-            restartText.setFont(font);
-            restartText.setCharacterSize(20);
-            restartText.setFillColor(sf::Color::White);
-            textRect = restartText.getLocalBounds();
-            restartText.setOrigin(textRect.left + textRect.width / 2.0f,
-                textRect.top + textRect.height / 2.0f);
-            restartText.setPosition(sf::Vector2f(gridSize * cellSize / 2.0f, gridSize * cellSize / 2.0f + 50));
-            window.draw(restartText);
+        bool joined = host ? host->connected() : client && client->connected();
+        if (joined != peerJoined) {
+            peerJoined = joined;
+            if (host) setStatusMessage(joined ? "Player %d joined" : "Player %d left", host->seat() + 1);
+            changed = true;
         }
+        return changed;
     }
 
-    void setStatusMessage(const std::string& message) {
-        statusMessage = message;
-        statusClock.restart();
+    // Why positions cannot be taken back or swapped right now, or null
+    const char* rewindBlocker() const {
+        if (recorder) return "while recording";
+        if (host || client) return "in a network game";
+        return nullptr;
     }
-        
-    void checkCollisions() {
-        // Check coin collections
-        for (int i = 0; i < coinCount; i++) {
-            p1.collectCoin(coins[i]);
-            p2.collectCoin(coins[i]);
-        }
 
-        // Check hurdle interactions
-        for (int i = 0; i < hurdleCount; i++) {
-            p1.handleHurdle(hurdles[i]);
-            p2.handleHurdle(hurdles[i]);
+    void selectPlayer(int index) {
+        if (state.currentPlayer != index) {
+            state.currentPlayer = index;
+            if (recorder) recorder->record(ReplayRecord::selectPlayer(index), state);
         }
+    }
 
-        // Check if any player reached the goal
-        if (p1.atGoal || p2.atGoal) {
-            gameOver = true;
+    void endPreview(bool kept) {
+        previewPending = false;
+        if (kept) {
+            keep(previewRecord);
+            setStatusMessage("Kept");
         }
+        else {
+            history.rollback(state);
+            state.currentPlayer = previewPlayer;
+            currentMode = MOVE_MODE;
+            setStatusMessage("Taken back");
+        }
+        releaseMoveKeys();
     }
 
-    void placeHurdle(int gridX, int gridY) {
-        // Make sure grid position is valid
-        if (gridX < 0 || gridX >= gridSize || gridY < 0 || gridY >= gridSize) {
-            setStatusMessage("Invalid position for placing hurdle!");
+    // Ctrl+Z and Ctrl+Y. Not while recording, for the same reason as F9.
+    void undoOrRedo(bool undo) {
+        if (rewindBlocker()) {
+            setStatusMessage("Cannot undo %s", rewindBlocker());
             return;
         }
-
-        // Don't place on player start or goal positions
-        if ((gridX == 4 && gridY == 0) || // P1 start
-            (gridX == 0 && gridY == 4) || // P2 start
-            (gridX == 2 && gridY == 2)) { // Goal
-            setStatusMessage("Cannot place hurdle on start or goal positions!");
+        if (!(undo ? history.undo(state) : history.redo(state))) {
+            setStatusMessage(undo ? "Nothing to undo" : "Nothing to redo");
             return;
         }
+        currentMode = MOVE_MODE;
+        releaseMoveKeys();
+        setStatusMessage("%s (%d to undo, %d to redo)", undo ? "Undone" : "Redone", history.undoSteps(), history.redoSteps());
+    }
 
-        // Check if position already has a coin or hurdle
-        for (int c = 0; c < coinCount; c++) {
-            if (!coins[c].collected && coins[c].x == gridX && coins[c].y == gridY) {
-                setStatusMessage("Cannot place hurdle on a coin!");
-                return;
-            }
+    void movePlayer(int index) {
+        Player& view = playerView(index);
+        if (remoteSeat(index)) {
+            setStatusMessage("%s plays on the other machine", view.name.c_str());
+            return;
         }
-
-        for (int h = 0; h < hurdleCount; h++) {
-            if (!hurdles[h].triggered && hurdles[h].x == gridX && hurdles[h].y == gridY) {
-                setStatusMessage("Cannot place hurdle on another hurdle!");
-                return;
-            }
+        if (!view.canMove) {
+            selectPlayer(index);
+            return;
         }
 
-        // Check if current player can buy the selected hurdle
-        Player& currentPlayerObj = (currentPlayer == 1) ? p1 : p2;
-        std::string hurdleTypeStr;
-        switch (selectedHurdleType) {
-        case FIRE: hurdleTypeStr = "fire"; break;
-        case SNAKE: hurdleTypeStr = "snake"; break;
-        case GHOST: hurdleTypeStr = "ghost"; break;
-        case LION: hurdleTypeStr = "lion"; break;
-        case LOCK: hurdleTypeStr = "lock"; break;
-        }
-
-        if (currentPlayerObj.buyHurdle(hurdleTypeStr)) {
-            // Find an inactive hurdle to replace or create a new one
-            bool placed = false;
-            for (int h = 0; h < hurdleCount; h++) {
-                if (hurdles[h].triggered) {
-                    hurdles[h] = Hurdle(gridX, gridY, selectedHurdleType);
-                    placed = true;
-                    break;
-                }
+        StepResult result = play(Action::move(index));
+        if (client && result.ok()) {
+            view.canMove = false;   // the host's answer carries no events
+        }
+        for (int i = 0; i < result.eventCount; i++) {
+            if (result.events[i].type == EVENT_MOVED) {
+                view.canMove = false; // Player must release key before moving again
             }
+        }
+        reportEvents(result);
+    }
 
-            if (!placed) {
-                // Create a new hurdle by replacing a random one
-                int idx = std::rand() % hurdleCount;
-                hurdles[idx] = Hurdle(gridX, gridY, selectedHurdleType);
-            }
+    void placeHurdle(int gridX, int gridY) {
+        StepResult result = play(Action::placeHurdle(state.currentPlayer, selectedHurdleType, gridX, gridY));
 
-            setStatusMessage(currentPlayerObj.name + " placed a " + hurdleTypeStr + " hurdle!");
+        switch (result.error) {
+        case STEP_OK:
+            setStatusMessage("%s placed a %s hurdle!", playerView(state.currentPlayer).name.c_str(), hurdleNames[selectedHurdleType]);
             currentMode = MOVE_MODE;
-        }
-        else {
+            break;
+        case STEP_INVALID_CELL:
+            setStatusMessage("Invalid position for placing hurdle!");
+            break;
+        case STEP_START_OR_GOAL:
+            setStatusMessage("Cannot place hurdle on start or goal positions!");
+            break;
+        case STEP_CELL_HAS_COIN:
+            setStatusMessage("Cannot place hurdle on a coin!");
+            break;
+        case STEP_CELL_HAS_HURDLE:
+            setStatusMessage("Cannot place hurdle on another hurdle!");
+            break;
+        case STEP_NOT_ENOUGH_COINS:
             setStatusMessage("Not enough coins to buy this hurdle!");
+            break;
+        case STEP_BOARD_FULL:
+            setStatusMessage("No room left on the board for another hurdle!");
+            break;
+        default:
+            break;
         }
     }
 
     void handleBuyItemMode(sf::Keyboard::Key key) {
-        Player& currentPlayerObj = (currentPlayer == 1) ? p1 : p2;
-        std::string itemType;
+        int item = -1;
 
         if (key == sf::Keyboard::H) {
             // Show helping objects submenu
-            setStatusMessage("Press: [1] Sword (40), [2] Shield (30), [3] Water (50), [4] Key (70)");
+            const ItemRule* items = rules().items;
+            setStatusMessage("Press: [1] Sword (%d%s), [2] Shield (%d%s), [3] Water (%d%s), [4] Key (%d%s)",
+                items[SWORD].cost, priceTags[items[SWORD].currency], items[SHIELD].cost, priceTags[items[SHIELD].currency],
+                items[WATER].cost, priceTags[items[WATER].currency], items[KEY].cost, priceTags[items[KEY].currency]);
             return;
         }
         else if (key == sf::Keyboard::B) {
             // Show blockages submenu
-            setStatusMessage("Press: [1] Fire (50), [2] Snake (30), [3] Ghost (20), [4] Lion (50-Gold), [5] Lock (60-Silver)");
+            const HurdleRule* hurdles = rules().hurdles;
+            setStatusMessage("Press: [1] Fire (%d%s), [2] Snake (%d%s), [3] Ghost (%d%s), [4] Lion (%d%s), [5] Lock (%d%s)",
+                hurdles[FIRE].cost, priceTags[hurdles[FIRE].currency], hurdles[SNAKE].cost, priceTags[hurdles[SNAKE].currency],
+                hurdles[GHOST].cost, priceTags[hurdles[GHOST].currency], hurdles[LION].cost, priceTags[hurdles[LION].currency],
+                hurdles[LOCK].cost, priceTags[hurdles[LOCK].currency]);
             return;
         }
         else if (key == sf::Keyboard::Num1 || key == sf::Keyboard::Numpad1) {
-            if (statusMessage.find("Sword") != std::string::npos) {
-                itemType = "sword";
+            if (std::strstr(statusMessage, "Sword")) {
+                item = SWORD;
             }
-            else if (statusMessage.find("Fire") != std::string::npos) {
+            else if (std::strstr(statusMessage, "Fire")) {
                 selectedHurdleType = FIRE;
                 currentMode = PLACE_HURDLE_MODE;
                 setStatusMessage("Click on the grid to place a FIRE hurdle");
@@ -959,10 +753,10 @@ public:
             }
         }
         else if (key == sf::Keyboard::Num2 || key == sf::Keyboard::Numpad2) {
-            if (statusMessage.find("Shield") != std::string::npos) {
-                itemType = "shield";
+            if (std::strstr(statusMessage, "Shield")) {
+                item = SHIELD;
             }
-            else if (statusMessage.find("Snake") != std::string::npos) {
+            else if (std::strstr(statusMessage, "Snake")) {
                 selectedHurdleType = SNAKE;
                 currentMode = PLACE_HURDLE_MODE;
                 setStatusMessage("Click on the grid to place a SNAKE hurdle");
@@ -970,10 +764,10 @@ public:
             }
         }
         else if (key == sf::Keyboard::Num3 || key == sf::Keyboard::Numpad3) {
-            if (statusMessage.find("Water") != std::string::npos) {
-                itemType = "water";
+            if (std::strstr(statusMessage, "Water")) {
+                item = WATER;
             }
-            else if (statusMessage.find("Ghost") != std::string::npos) {
+            else if (std::strstr(statusMessage, "Ghost")) {
                 selectedHurdleType = GHOST;
                 currentMode = PLACE_HURDLE_MODE;
                 setStatusMessage("Click on the grid to place a GHOST hurdle");
@@ -981,17 +775,17 @@ public:
             }
         }
         else if (key == sf::Keyboard::Num4 || key == sf::Keyboard::Numpad4) {
-            if (statusMessage.find("Key") != std::string::npos) {
-                itemType = "key";
+            if (std::strstr(statusMessage, "Key")) {
+                item = KEY;
             }
-            else if (statusMessage.find("Lion") != std::string::npos) {
+            else if (std::strstr(statusMessage, "Lion")) {
                 selectedHurdleType = LION;
                 currentMode = PLACE_HURDLE_MODE;
                 setStatusMessage("Click on the grid to place a LION hurdle");
                 return;
             }
         }
-        else if ((key == sf::Keyboard::Num5 || key == sf::Keyboard::Numpad5) && statusMessage.find("Lock") != std::string::npos) {
+        else if ((key == sf::Keyboard::Num5 || key == sf::Keyboard::Numpad5) && std::strstr(statusMessage, "Lock")) {
             selectedHurdleType = LOCK;
             currentMode = PLACE_HURDLE_MODE;
             setStatusMessage("Click on the grid to place a LOCK hurdle");
@@ -1003,9 +797,9 @@ public:
             return;
         }
 
-        if (!itemType.empty()) {
-            if (currentPlayerObj.buyItem(itemType)) {
-                setStatusMessage(currentPlayerObj.name + " bought a " + itemType + "!");
+        if (item >= 0) {
+            if (play(Action::buyItem(state.currentPlayer, static_cast<ItemType>(item))).ok()) {
+                setStatusMessage("%s bought a %s!", playerView(state.currentPlayer).name.c_str(), itemNames[item]);
                 currentMode = MOVE_MODE;
             }
             else {
@@ -1014,104 +808,485 @@ public:
         }
     }
 
-    void handleEvents() {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed) {
-                window.close();
+    // Playback only takes keys that move through the recording
+    void handleReplayKey(sf::Keyboard::Key key) {
+        int target = replayTurn;
+        if (key == sf::Keyboard::Right) target++;
+        else if (key == sf::Keyboard::Left) target--;
+        else if (key == sf::Keyboard::PageDown) target += replayKeyframeInterval;
+        else if (key == sf::Keyboard::PageUp) target -= replayKeyframeInterval;
+        else if (key == sf::Keyboard::Home) target = 0;
+        else if (key == sf::Keyboard::End) target = replay->turnCount();
+        target = std::max(0, std::min(target, replay->turnCount()));
+        if (target == replayTurn) return;
+
+        if (!seekReplay(*replay, target, state)) {
+            setStatusMessage("Replay does not match these rules before turn %d", target);
+            return;
+        }
+        replayTurn = target;
+        setStatusMessage("Replay turn %d of %d", replayTurn, replay->turnCount());
+    }
+
+    // F5 writes the position on screen to savePath, replays included
+    void saveSnapshot() {
+        std::string error;
+        if (saveSnapshots(savePath, &state, 1, error)) {
+            setStatusMessage("Saved to %s", savePath);
+        }
+        else {
+            std::cerr << error << std::endl;
+            setStatusMessage("Could not save to %s", savePath);
+        }
+    }
+
+    // F9 goes back to the position in savePath. Not while recording: the
+    // replay would no longer follow from its own moves. Nor in a network
+    // game, where the host's board is the real one.
+    void restoreSnapshot() {
+        if (rewindBlocker()) {
+            setStatusMessage("Cannot restore a save %s", rewindBlocker());
+            return;
+        }
+        std::string error;
+        SnapshotArchive archive;
+        if (!archive.open(savePath, error) || !unpackSnapshot(archive.at(archive.count() - 1), state)) {
+            if (!error.empty()) std::cerr << error << std::endl;
+            setStatusMessage("Could not restore %s", savePath);
+            return;
+        }
+        currentMode = MOVE_MODE;
+        placingHurdle = false;
+        previewPending = false;
+        history.reset(state);
+        releaseMoveKeys();
+        setStatusMessage("Restored %s", savePath);
+    }
+
+    void releaseMoveKeys() {
+        for (int p = 0; p < playerCount; p++) {
+            players[p].canMove = true;
+        }
+    }
+
+    // Applies one window event; returns true if the screen needs redrawing
+    bool handleEvent(const sf::Event& event) {
+        if (event.type == sf::Event::Closed) {
+            window.close();
+        }
+        else if (event.type == sf::Event::Resized) {
+            boardDirty = true;
+        }
+        else if (event.type == sf::Event::KeyPressed) {
+            if (event.key.code == sf::Keyboard::F5) {
+                saveSnapshot();
+                return true;
+            }
+            if (replay) {
+                handleReplayKey(event.key.code);
+                return true;
+            }
+            if (event.key.code == sf::Keyboard::F9) {
+                restoreSnapshot();
+                return true;
+            }
+            if (watching()) {
+                setStatusMessage("Watching only; the match is played elsewhere");
+                return true;
+            }
+            if (previewPending) {
+                if (event.key.code == sf::Keyboard::Enter) endPreview(true);
+                else if (event.key.code == sf::Keyboard::Escape) endPreview(false);
+                return true;
             }
-            else if (event.type == sf::Event::KeyPressed) {
-                if (gameOver) {
-                    continue; 
+            if (event.key.control && (event.key.code == sf::Keyboard::Z || event.key.code == sf::Keyboard::Y)) {
+                undoOrRedo(event.key.code == sf::Keyboard::Z);
+                return true;
+            }
+            if (state.gameOver) {
+                return false;
+            }
+            if (event.key.code == sf::Keyboard::P) {
+                if (!previewing && (host || client)) {
+                    setStatusMessage("Cannot preview in a network game");
+                    return true;
                 }
+                previewing = !previewing;
+                setStatusMessage(previewing ? "Preview on: actions are tried out until kept" : "Preview off");
+                return true;
+            }
 
-                // Handle player movement keys
-                if (currentMode == MOVE_MODE) {
-                    if (event.key.code == sf::Keyboard::Num1 || event.key.code == sf::Keyboard::Numpad1) {
-                        currentPlayer = 1;
-                        p1.move();
-                        checkCollisions();
-                    }
-                    else if (event.key.code == sf::Keyboard::Num2 || event.key.code == sf::Keyboard::Numpad2) {
-                        currentPlayer = 2;
-                        p2.move();
-                        checkCollisions();
-                    }
-                    else if (event.key.code == sf::Keyboard::B) {
-                        currentMode = BUY_MODE;
-                        setStatusMessage("Buy Mode: Press [H]elping Objects or [B]lockages");
-                    }
-                }
-                else if (currentMode == BUY_MODE) {
-                    handleBuyItemMode(event.key.code);
+            // Handle player movement keys
+            if (currentMode == MOVE_MODE) {
+                int mover = playerForKey(event.key.code);
+                if (mover >= 0) {
+                    movePlayer(mover);
                 }
-                else if (currentMode == PLACE_HURDLE_MODE) {
-                    if (event.key.code == sf::Keyboard::Escape || event.key.code == sf::Keyboard::M) {
-                        currentMode = MOVE_MODE;
-                        setStatusMessage("Returned to move mode");
-                    }
+                else if (event.key.code == sf::Keyboard::B) {
+                    currentMode = BUY_MODE;
+                    setStatusMessage("Buy Mode: Press [H]elping Objects or [B]lockages");
                 }
-
-                // Common keys for all modes
-                if (event.key.code == sf::Keyboard::M) {
+            }
+            else if (currentMode == BUY_MODE) {
+                handleBuyItemMode(event.key.code);
+            }
+            else if (currentMode == PLACE_HURDLE_MODE) {
+                if (event.key.code == sf::Keyboard::Escape || event.key.code == sf::Keyboard::M) {
                     currentMode = MOVE_MODE;
-                    setStatusMessage("Move Mode");
-                }
-                else if (event.key.code == sf::Keyboard::Key::Space) {
-                    p1.canMove = true;
-                    p2.canMove = true;
+                    setStatusMessage("Returned to move mode");
                 }
             }
-            else if (event.type == sf::Event::KeyReleased) {
-                if (event.key.code == sf::Keyboard::Num1 || event.key.code == sf::Keyboard::Numpad1 ||
-                    event.key.code == sf::Keyboard::Num2 || event.key.code == sf::Keyboard::Numpad2) {
-                    p1.canMove = true;
-                    p2.canMove = true;
-                }
+
+            // Common keys for all modes
+            if (event.key.code == sf::Keyboard::M) {
+                currentMode = MOVE_MODE;
+                setStatusMessage("Move Mode");
+            }
+            else if (event.key.code == sf::Keyboard::Key::Space) {
+                releaseMoveKeys();
             }
-            else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
-                if (currentMode == PLACE_HURDLE_MODE) {
-                    sf::Vector2i pixelPos = sf::Mouse::getPosition(window);
-                    sf::Vector2f worldPos = window.mapPixelToCoords(pixelPos);
+        }
+        else if (event.type == sf::Event::KeyReleased) {
+            if (playerForKey(event.key.code) >= 0) {
+                releaseMoveKeys();
+            }
+        }
+        else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Left) {
+            if (currentMode == PLACE_HURDLE_MODE) {
+                sf::Vector2i pixelPos = sf::Mouse::getPosition(window);
+                sf::Vector2f worldPos = window.mapPixelToCoords(pixelPos);
 
-                    int gridX = worldPos.x / cellSize;
-                    int gridY = worldPos.y / cellSize;
+                int gridX = worldPos.x / cellSize;
+                int gridY = worldPos.y / cellSize;
 
 
 
-                    if (gridX >= 0 && gridX < gridSize && gridY >= 0 && gridY < gridSize) {
-                        placeHurdle(gridX, gridY);
-                    }
+                if (gridX >= 0 && gridX < gridSize && gridY >= 0 && gridY < gridSize) {
+                    placeHurdle(gridX, gridY);
                 }
             }
         }
+        return event.type != sf::Event::MouseMoved;
+    }
+
+    // handleEvent, with whatever it allocates charged to the next frame
+    bool applyEvent(const sf::Event& event) {
+        AllocScope scope;
+        bool changed = handleEvent(event);
+        frameAllocations += scope.count();
+        return changed;
     }
 
     void draw() {
+        AllocScope scope;
         window.clear(sf::Color(50, 50, 50));
 
         drawGrid();
-        drawCoins();
-        drawHurdles();
-        p1.draw(window);
-        p2.draw(window);
-        drawScores();
-        drawShop();
-        drawGameStatus();
+        drawEntities();
+        drawHud();
 
         window.display();
+        frameAllocations += scope.count();
+        checkFrameAllocations();
+    }
+
+    // Input handling and drawing are expected to stay off the heap once the
+    // atlases exist; SFML's own event queue is not counted
+    void checkFrameAllocations() {
+        framesDrawn++;
+        if (allocCheck != ALLOC_IGNORE && frameAllocations > 0) {
+            std::cerr << "Frame " << framesDrawn << ": " << frameAllocations << " heap allocation(s)" << std::endl;
+            if (allocCheck == ALLOC_FAIL && framesDrawn > allocWarmupFrames) {
+                std::cerr << "Allocation check failed: frames must not allocate after warm-up" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        frameAllocations = 0;
     }
 
+    void showLoadingScreen() {
+        sf::Clock clock;
+        sf::RectangleShape track(sf::Vector2f(gridSize * cellSize - 100, 12));
+        track.setPosition(50, (gridSize * cellSize + hudHeight) / 2.0f);
+        track.setFillColor(sf::Color(80, 80, 80));
+        sf::RectangleShape bar(sf::Vector2f(80, 12));
+        bar.setFillColor(sf::Color(255, 215, 0));
+
+        while (window.isOpen() && !ResourceManager::instance().ready()) {
+            sf::Event event;
+            while (window.pollEvent(event)) {
+                if (event.type == sf::Event::Closed) {
+                    window.close();
+                }
+            }
+
+            // Bar slides along the track until loading finishes
+            float travel = gridSize * cellSize - 180;
+            float phase = clock.getElapsedTime().asSeconds() * 0.8f;
+            phase -= static_cast<int>(phase);
+            bar.setPosition(50 + travel * phase, (gridSize * cellSize + hudHeight) / 2.0f);
+
+            window.clear(sf::Color(50, 50, 50));
+            window.draw(track);
+            window.draw(bar);
+            window.display();
+            sf::sleep(sf::milliseconds(16));
+        }
+
+        font = ResourceManager::instance().fonts.get("arial.ttf");
+        setupHud();
+
+        sf::Color tokenColors[playerCount];
+        for (int p = 0; p < playerCount; p++) {
+            tokenColors[p] = players[p].color;
+        }
+        atlas.build(*font, tokenColors);
+        sprites.resize(entityCapacity * 2 + playerCount * 2);
+    }
+
+    // Time until something on screen changes by itself (the status message
+    // expiring), or a negative time if nothing is scheduled
+    sf::Time nextTimedChange() const {
+        const sf::Time statusLifetime = sf::seconds(5.0f);
+        if (statusMessage[0] == '\0') return sf::seconds(-1);
+        sf::Time shown = statusClock.getElapsedTime();
+        return shown < statusLifetime ? statusLifetime - shown : sf::seconds(-1);
+    }
+
+    // Event-driven loop: sleeps in waitEvent while nothing is happening and
+    // redraws only after input or when a timed element changes
     void run() {
+        showLoadingScreen();
+        if (frameLimit > 0) {
+            window.setFramerateLimit(frameLimit);
+        }
+
+        bool needsRedraw = true;
         while (window.isOpen()) {
-            handleEvents();
-            draw();
+            if (needsRedraw) {
+                draw();
+                needsRedraw = false;
+            }
+
+            // A network game also wakes up to look at the socket
+            sf::Event event;
+            sf::Time timeout = nextTimedChange();
+            bool netWake = (host || client) && (timeout < sf::Time::Zero || timeout > netPollInterval);
+            if (netWake) {
+                timeout = netPollInterval;
+            }
+            if (timeout < sf::Time::Zero) {
+                // Nothing scheduled: block until the next input
+                if (!window.waitEvent(event)) continue;
+                needsRedraw = applyEvent(event);
+            }
+            else {
+                // SFML cannot wait with a timeout, so doze in short slices
+                // until either input arrives or the deadline passes
+                sf::Clock waited;
+                bool gotEvent = false;
+                while (!gotEvent && waited.getElapsedTime() < timeout) {
+                    gotEvent = window.pollEvent(event);
+                    if (!gotEvent) {
+                        sf::sleep(std::min(timeout - waited.getElapsedTime(), sf::milliseconds(15)));
+                    }
+                }
+                needsRedraw = gotEvent ? applyEvent(event) : !netWake;
+            }
+
+            // Drain anything else that queued up meanwhile
+            while (window.pollEvent(event)) {
+                needsRedraw = applyEvent(event) || needsRedraw;
+            }
+            if (host || client) {
+                needsRedraw = pollNetwork() || needsRedraw;
+            }
+            // Costs a compare when nothing changed
+            if (feed) {
+                feed->publish(state);
+            }
         }
     }
 };
 
-int main() {
-    Game game;
+int main(int argc, char* argv[]) {
+    std::random_device entropy;
+    GameOptions options = { (static_cast<uint64_t>(entropy()) << 32) ^ static_cast<uint64_t>(std::time(0)), 0, ALLOC_IGNORE,
+        nullptr, nullptr, nullptr, "save.aqs", UndoHistory::defaultCapacity, nullptr, nullptr, nullptr };
+    const char* rulesPath = "rules.txt";
+    bool rulesRequired = false;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* resumePath = nullptr;
+    int resumePosition = 0;
+    int hostPort = -1;
+    const char* joinAddress = nullptr;
+    int spectatePort = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            options.frameLimit = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            resumePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--position") == 0 && i + 1 < argc) {
+            resumePosition = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            options.savePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--undo") == 0 && i + 1 < argc) {
+            options.undoSteps = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            hostPort = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+            joinAddress = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+            spectatePort = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--rules") == 0 && i + 1 < argc) {
+            rulesPath = argv[++i];
+            rulesRequired = true;
+        }
+        else if (std::strcmp(argv[i], "--alloc-report") == 0) {
+            options.allocCheck = ALLOC_REPORT;
+        }
+        else if (std::strcmp(argv[i], "--alloc-check") == 0) {
+            options.allocCheck = ALLOC_FAIL;
+        }
+    }
+
+    if (options.allocCheck != ALLOC_IGNORE && !AllocTracker::enabled()) {
+        std::cerr << "Allocation tracking is not compiled in; rebuild with -DAQ_TRACK_ALLOCATIONS" << std::endl;
+        return 1;
+    }
+
+    // Prices and hurdle effects; the built-in rules stand in for a missing
+    // or broken rules.txt, but a file named with --rules must load
+    Catalog catalog;
+    std::string error;
+    if (loadCatalog(rulesPath, catalog, error)) {
+        setRules(catalog);
+    }
+    else {
+        std::cerr << error << std::endl;
+        if (rulesRequired) return 1;
+        std::cerr << "Using the built-in rules" << std::endl;
+    }
+
+    // A replay brings its own board and must be played under the rules it
+    // was recorded with
+    ReplayFile replay;
+    if (replayPath) {
+        if (!replay.open(replayPath, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (replay.header().rulesHash != catalogHash(rules())) {
+            std::cerr << replayPath << ": recorded under different rules; pass the same --rules file" << std::endl;
+            return 1;
+        }
+        options.seed = replay.header().seed;
+        options.replay = &replay;
+    }
+
+    // Network play: the host keeps the real board, the joining machine
+    // starts from the position the host sends
+    NetHost host;
+    NetClient client;
+    GameState joined;
+    if (joinAddress) {
+        if (hostPort >= 0 || recordPath || replayPath || resumePath) {
+            std::cerr << "--join plays the host's board; it cannot be combined with --host, --record, --replay or --resume" << std::endl;
+            return 1;
+        }
+        std::string address = joinAddress;
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            std::cerr << "--join takes HOST:PORT" << std::endl;
+            return 1;
+        }
+        uint16_t port = static_cast<uint16_t>(std::atoi(address.c_str() + colon + 1));
+        if (!client.connect(address.substr(0, colon).c_str(), port, joined, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        options.seed = joined.seed;
+        options.resume = &joined;
+        options.client = &client;
+    }
+    else if (hostPort >= 0) {
+        if (replayPath) {
+            std::cerr << "--host plays a live game; it cannot be combined with --replay" << std::endl;
+            return 1;
+        }
+        if (!host.open(static_cast<uint16_t>(hostPort), playerCount - 1, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        std::cout << "Hosting on port " << host.port() << "; Player " << playerCount << " joins with --join <this machine>:"
+            << host.port() << std::endl;
+        options.host = &host;
+    }
+
+    // Viewers watch whatever this window shows, with --join on the port
+    SpectatorFeed feed;
+    if (spectatePort >= 0) {
+        if (!feed.open(static_cast<uint16_t>(spectatePort), error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        std::cout << "Spectators watch with --join <this machine>:" << feed.port() << std::endl;
+        options.feed = &feed;
+    }
+
+    // A saved position, picked out of the archive by --position
+    GameState resumed;
+    if (resumePath && !replayPath) {
+        if (recordPath) {
+            std::cerr << "--record starts from a new board; it cannot be combined with --resume" << std::endl;
+            return 1;
+        }
+        SnapshotArchive archive;
+        if (!archive.open(resumePath, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (resumePosition < 0 || resumePosition >= archive.count()) {
+            std::cerr << resumePath << " holds positions 0 to " << archive.count() - 1 << std::endl;
+            return 1;
+        }
+        if (!unpackSnapshot(archive.at(resumePosition), resumed)) {
+            std::cerr << resumePath << ": position " << resumePosition << " is damaged" << std::endl;
+            return 1;
+        }
+        options.seed = resumed.seed;
+        options.resume = &resumed;
+    }
+
+    ReplayRecorder recorder;
+    if (recordPath && !replayPath) {
+        if (!recorder.open(recordPath, options.seed, replayKeyframeInterval, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        options.recorder = &recorder;
+    }
+
+    Game game(options);
     game.run();
     return 0;
-}
\ No newline at end of file
+}
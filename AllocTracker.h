@@ -0,0 +1,26 @@
+#pragma once
+
+// Counts heap allocations made through the global operator new, the
+// over-aligned forms included. The counting operators are only compiled
+// in with -DAQ_TRACK_ALLOCATIONS; without it enabled() is false and every
+// count reads zero.
+class AllocTracker {
+public:
+    static bool enabled();
+
+    // Allocations made by the whole process so far
+    static unsigned long long allocations();
+};
+
+// Allocations made between construction and count()
+class AllocScope {
+public:
+    AllocScope() : start(AllocTracker::allocations()) {}
+
+    unsigned long long count() const {
+        return AllocTracker::allocations() - start;
+    }
+
+private:
+    unsigned long long start;
+};
@@ -0,0 +1,1060 @@
+#include "BatchRunner.h"
+#include "AllocTracker.h"
+#include "Bitboard.h"
+#include "Catalog.h"
+#include "NetPlay.h"
+#include "Replay.h"
+#include "SimdBatch.h"
+#include "Snapshot.h"
+#include "Spectator.h"
+#include "Turns.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+BatchStats::BatchStats() : games(0), ties(0), unfinished(0), totalTurns(0), shortestGame(0), longestGame(0) {
+    std::fill(wins, wins + playerCount, 0LL);
+    std::fill(hurdleHits, hurdleHits + hurdleTypeCount, 0LL);
+    std::fill(hurdleBlocks, hurdleBlocks + hurdleTypeCount, 0LL);
+    std::fill(hurdlesPlaced, hurdlesPlaced + hurdleTypeCount, 0LL);
+    std::fill(itemsBought, itemsBought + itemTypeCount, 0LL);
+    std::fill(coinsCollected, coinsCollected + 2, 0LL);
+    std::fill(coinsOnBoard, coinsOnBoard + 2, 0LL);
+}
+
+void BatchStats::merge(const BatchStats& other) {
+    if (other.games == 0) return;
+
+    shortestGame = games == 0 ? other.shortestGame : std::min(shortestGame, other.shortestGame);
+    longestGame = std::max(longestGame, other.longestGame);
+    games += other.games;
+    ties += other.ties;
+    unfinished += other.unfinished;
+    totalTurns += other.totalTurns;
+    for (int p = 0; p < playerCount; p++) wins[p] += other.wins[p];
+    for (int h = 0; h < hurdleTypeCount; h++) {
+        hurdleHits[h] += other.hurdleHits[h];
+        hurdleBlocks[h] += other.hurdleBlocks[h];
+        hurdlesPlaced[h] += other.hurdlesPlaced[h];
+    }
+    for (int i = 0; i < itemTypeCount; i++) itemsBought[i] += other.itemsBought[i];
+    for (int c = 0; c < 2; c++) {
+        coinsCollected[c] += other.coinsCollected[c];
+        coinsOnBoard[c] += other.coinsOnBoard[c];
+    }
+}
+
+static void record(const StepResult& result, BatchStats& stats) {
+    for (int i = 0; i < result.eventCount; i++) {
+        const GameEvent& e = result.events[i];
+        switch (e.type) {
+        case EVENT_COIN_COLLECTED: stats.coinsCollected[e.detail]++; break;
+        case EVENT_HURDLE_HIT: stats.hurdleHits[e.detail]++; break;
+        case EVENT_HURDLE_BLOCKED: stats.hurdleBlocks[e.detail]++; break;
+        case EVENT_ITEM_BOUGHT: stats.itemsBought[e.detail]++; break;
+        case EVENT_HURDLE_PLACED: stats.hurdlesPlaced[e.detail]++; break;
+        default: break;
+        }
+    }
+}
+
+uint64_t gameSeed(uint64_t batchSeed, long long gameIndex) {
+    return Rng(batchSeed, static_cast<uint64_t>(gameIndex)).next();
+}
+
+// Policies and the game loop run on either representation through the
+// matching newGame/step/winner overloads
+
+// Steps one action and counts what happened; accepted actions are also
+// logged to `recorder` when there is one
+template <typename State>
+static StepResult act(State& state, const Action& action, BatchStats& stats, ReplayRecorder* recorder) {
+    StepResult result = step(state, action);
+    record(result, stats);
+    if (recorder && result.ok()) {
+        recorder->record(ReplayRecord::of(action), state);
+    }
+    return result;
+}
+
+template <typename State>
+static void randomPolicy(State& state, int player, Rng& rng, BatchStats& stats, ReplayRecorder* recorder) {
+    switch (rng.below(10)) {
+    case 0:
+        act(state, Action::buyItem(player, static_cast<ItemType>(rng.below(itemTypeCount))), stats, recorder);
+        break;
+    case 1:
+        act(state, Action::placeHurdle(player, static_cast<HurdleType>(rng.below(hurdleTypeCount)),
+            rng.below(gridSize), rng.below(gridSize)), stats, recorder);
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename State>
+static void scriptedPolicy(State& state, int player, BatchStats& stats, ReplayRecorder* recorder) {
+    const auto& me = state.players[player];
+
+    // Keep one of every helping object
+    for (int i = 0; i < itemTypeCount; i++) {
+        if (me.items[i] == 0) {
+            act(state, Action::buyItem(player, static_cast<ItemType>(i)), stats, recorder);
+            return;
+        }
+    }
+
+    // Spend spare money on a ghost just ahead of the opponent
+    int wealth = me.goldCoins * GOLD_COIN_POINTS + me.silverCoins * SILVER_COIN_POINTS;
+    if (wealth < rules().hurdles[GHOST].cost + rules().items[KEY].cost) return;
+
+    int opponent = (player + 1) % playerCount;
+    int opponentPos = state.players[opponent].pos;
+    for (int ahead = opponentPos + 1; ahead <= opponentPos + 3 && ahead < pathLen; ahead++) {
+        Cell cell = pathCell(opponent, ahead);
+        if (act(state, Action::placeHurdle(player, GHOST, cell.x, cell.y), stats, recorder).ok()) {
+            return;
+        }
+    }
+}
+
+static void countBoardCoins(const GameState& state, BatchStats& stats) {
+    for (int c = 0; c < state.coins.end(); c++) {
+        stats.coinsOnBoard[state.coins.type[c]]++;
+    }
+}
+
+static void countBoardCoins(const BitboardState& board, BatchStats& stats) {
+    stats.coinsOnBoard[GOLD] += board.goldCells.count();
+    stats.coinsOnBoard[SILVER] += (board.coinCells & ~board.goldCells).count();
+}
+
+// The policy's move for `player`, if it makes one before moving. Players
+// sitting the turn out do not shop.
+template <typename State>
+static void runPolicy(State& state, int player, const BatchConfig& config, Rng& rng, BatchStats& stats,
+    ReplayRecorder* recorder = nullptr) {
+    if (state.players[player].skipTurns > 0) return;
+
+    if (config.policy == POLICY_SCRIPTED) {
+        scriptedPolicy(state, player, stats, recorder);
+    }
+    else if (config.policy == POLICY_RANDOM) {
+        randomPolicy(state, player, rng, stats, recorder);
+    }
+}
+
+template <typename State>
+static void playGame(long long gameIndex, const BatchConfig& config, BatchStats& stats) {
+    State state;
+    newGame(state, gameSeed(config.seed, gameIndex));
+    Rng rng(state.seed, 1);   // separate stream so policies never shift the board
+
+    countBoardCoins(state, stats);
+
+    // Sat-out turns are skipped over rather than stepped, but still count
+    TurnScheduler scheduler(state);
+    while (!state.gameOver) {
+        int player = scheduler.next(state, config.maxTurns);
+        if (player < 0) break;
+        runPolicy(state, player, config, rng, stats);
+        StepResult result = step(state, Action::move(player));
+        record(result, stats);
+        scheduler.played(state, player, result);
+    }
+    int turns = static_cast<int>(scheduler.turnsPlayed());
+
+    stats.shortestGame = stats.games == 0 ? turns : std::min(stats.shortestGame, turns);
+    stats.longestGame = std::max(stats.longestGame, turns);
+    stats.games++;
+    stats.totalTurns += turns;
+
+    if (!state.gameOver) {
+        stats.unfinished++;
+        return;
+    }
+    int w = winner(state);
+    if (w < 0) stats.ties++;
+    else stats.wins[w]++;
+}
+
+// Move-only games for `count` consecutive game indices, one per lane
+static void playBatch(long long firstGame, long long count, const BatchConfig& config, BatchStats& stats) {
+    SimdBatch batch;
+    clearBatch(batch);
+
+    GameState state;
+    for (int lane = 0; lane < count; lane++) {
+        newGame(state, gameSeed(config.seed, firstGame + lane));
+        packLane(batch, lane, state);
+        for (int c = 0; c < state.coins.end(); c++) {
+            stats.coinsOnBoard[state.coins.type[c]]++;
+        }
+    }
+
+    int player = 0;
+    for (int turn = 0; turn < config.maxTurns && !allLanesOver(batch); turn++) {
+        stepMoves(batch, player);
+        player = (player + 1) % playerCount;
+    }
+
+    for (int lane = 0; lane < count; lane++) {
+        int turns = batch.turns[lane];
+        stats.shortestGame = stats.games == 0 ? turns : std::min(stats.shortestGame, turns);
+        stats.longestGame = std::max(stats.longestGame, turns);
+        stats.games++;
+        stats.totalTurns += turns;
+
+        for (int h = 0; h < hurdleTypeCount; h++) {
+            stats.hurdleHits[h] += batch.hurdleHits[h][lane];
+            stats.hurdleBlocks[h] += batch.hurdleBlocks[h][lane];
+        }
+        stats.coinsCollected[GOLD] += batch.coinsCollected[GOLD][lane];
+        stats.coinsCollected[SILVER] += batch.coinsCollected[SILVER][lane];
+
+        if (!batch.gameOver[lane]) {
+            stats.unfinished++;
+            continue;
+        }
+        unpackLane(batch, lane, state);
+        int w = winner(state);
+        if (w < 0) stats.ties++;
+        else stats.wins[w]++;
+    }
+}
+
+// Each worker owns a range of game indices and hands itself small chunks
+// from the front. A worker that runs dry steals the back half of another
+// worker's range, so uneven game lengths never leave a core idle.
+struct alignas(64) WorkRange {
+    std::mutex lock;
+    long long begin;
+    long long end;
+};
+
+static bool takeWork(WorkRange* ranges, int workers, int self, long long grain, long long& first, long long& last) {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(ranges[self].lock);
+            if (ranges[self].begin < ranges[self].end) {
+                first = ranges[self].begin;
+                last = std::min(first + grain, ranges[self].end);
+                ranges[self].begin = last;
+                return true;
+            }
+        }
+
+        bool stolen = false;
+        for (int i = 1; i < workers && !stolen; i++) {
+            WorkRange& victim = ranges[(self + i) % workers];
+            long long stealBegin, stealEnd;
+            {
+                std::lock_guard<std::mutex> guard(victim.lock);
+                long long remaining = victim.end - victim.begin;
+                if (remaining <= 0) continue;
+                stealBegin = victim.begin + remaining / 2;
+                stealEnd = victim.end;
+                victim.end = stealBegin;
+            }
+            std::lock_guard<std::mutex> guard(ranges[self].lock);
+            ranges[self].begin = stealBegin;
+            ranges[self].end = stealEnd;
+            stolen = true;
+        }
+        if (!stolen) return false;
+    }
+}
+
+BatchStats runBatch(const BatchConfig& config) {
+    int workers = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    if (workers < 1) workers = 1;
+
+    std::unique_ptr<WorkRange[]> ranges(new WorkRange[workers]);
+    for (int w = 0; w < workers; w++) {
+        ranges[w].begin = config.games * w / workers;
+        ranges[w].end = config.games * (w + 1) / workers;
+    }
+
+    const long long grain = 256;
+    std::vector<BatchStats> partial(workers);
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < workers; w++) {
+        threads.emplace_back([&, w]() {
+            long long first, last;
+            while (takeWork(ranges.get(), workers, w, grain, first, last)) {
+                if (config.vectorized) {
+                    for (long long g = first; g < last; g += simdLanes) {
+                        playBatch(g, std::min<long long>(simdLanes, last - g), config, partial[w]);
+                    }
+                }
+                else if (config.bitboard) {
+                    for (long long g = first; g < last; g++) {
+                        playGame<BitboardState>(g, config, partial[w]);
+                    }
+                }
+                else {
+                    for (long long g = first; g < last; g++) {
+                        playGame<GameState>(g, config, partial[w]);
+                    }
+                }
+            }
+        });
+    }
+
+    BatchStats total;
+    for (int w = 0; w < workers; w++) {
+        threads[w].join();
+        total.merge(partial[w]);
+    }
+    return total;
+}
+
+static bool sameState(const GameState& a, const GameState& b) {
+    for (int p = 0; p < playerCount; p++) {
+        const PlayerState& x = a.players[p];
+        const PlayerState& y = b.players[p];
+        if (x.pos != y.pos || x.skipTurns != y.skipTurns || x.goldCoins != y.goldCoins ||
+            x.silverCoins != y.silverCoins || x.score != y.score || x.atGoal != y.atGoal) {
+            return false;
+        }
+        for (int i = 0; i < itemTypeCount; i++) {
+            if (x.items[i] != y.items[i]) return false;
+        }
+    }
+    // Slot for slot; the order slots were freed in is not compared
+    if (a.coins.end() != b.coins.end() || a.hurdles.end() != b.hurdles.end()) return false;
+    for (int c = 0; c < a.coins.end(); c++) {
+        if (a.coins.isLive(c) != b.coins.isLive(c)) return false;
+        if (!a.coins.isLive(c)) continue;
+        if (a.coins.cell[c] != b.coins.cell[c] || a.coins.type[c] != b.coins.type[c]) return false;
+    }
+    for (int h = 0; h < a.hurdles.end(); h++) {
+        if (a.hurdles.isLive(h) != b.hurdles.isLive(h)) return false;
+        if (!a.hurdles.isLive(h)) continue;
+        if (a.hurdles.cell[h] != b.hurdles.cell[h] || a.hurdles.type[h] != b.hurdles.type[h]) return false;
+    }
+    return a.gameOver == b.gameOver;
+}
+
+bool verifyVectorized(long long games, int maxTurns, uint64_t seed) {
+    GameState scalar[simdLanes];
+    GameState unpacked;
+    SimdBatch batch;
+
+    for (long long first = 0; first < games; first += simdLanes) {
+        clearBatch(batch);
+        for (int lane = 0; lane < simdLanes; lane++) {
+            newGame(scalar[lane], gameSeed(seed, first + lane));
+            // Exercise skip turns and pushback from the first move
+            scalar[lane].players[lane % playerCount].skipTurns = lane % 3;
+            packLane(batch, lane, scalar[lane]);
+        }
+
+        int player = 0;
+        for (int turn = 0; turn < maxTurns && !allLanesOver(batch); turn++) {
+            stepMoves(batch, player);
+            for (int lane = 0; lane < simdLanes; lane++) {
+                step(scalar[lane], Action::move(player));
+                unpackLane(batch, lane, unpacked);
+                if (!sameState(scalar[lane], unpacked)) {
+                    std::cerr << "Vectorized kernel diverged in game " << first + lane
+                        << " (board seed " << scalar[lane].seed << ") at turn " << turn + 1 << std::endl;
+                    return false;
+                }
+            }
+            player = (player + 1) % playerCount;
+        }
+    }
+    return true;
+}
+
+// Every step() result on the bitboard must match the GameState one, and the
+// GameState converted to a bitboard must equal the bitboard itself
+static bool sameStep(const StepResult& a, const StepResult& b, const GameState& state, const BitboardState& board) {
+    if (a.error != b.error || a.eventCount != b.eventCount) return false;
+    BitboardState converted;
+    toBitboard(state, converted);
+    return sameBoard(converted, board);
+}
+
+bool verifyBitboard(const BatchConfig& config) {
+    BatchStats scalarStats, boardStats;
+    GameState state;
+    BitboardState board;
+
+    for (long long g = 0; g < config.games; g++) {
+        newGame(state, gameSeed(config.seed, g));
+        newGame(board, gameSeed(config.seed, g));
+        Rng scalarRng(state.seed, 1);
+        Rng boardRng(board.seed, 1);
+
+        int player = 0;
+        for (int turn = 0; turn < config.maxTurns && !state.gameOver; turn++) {
+            runPolicy(state, player, config, scalarRng, scalarStats);
+            runPolicy(board, player, config, boardRng, boardStats);
+            StepResult a = step(state, Action::move(player));
+            StepResult b = step(board, Action::move(player));
+            if (!sameStep(a, b, state, board) || board.gameOver != state.gameOver) {
+                std::cerr << "Bitboard diverged in game " << g << " (board seed " << state.seed
+                    << ") at turn " << turn + 1 << std::endl;
+                return false;
+            }
+            player = (player + 1) % playerCount;
+        }
+
+        GameState roundTrip;
+        fromBitboard(board, roundTrip);
+        BitboardState again;
+        toBitboard(roundTrip, again);
+        if (!sameBoard(board, again) || winner(board) != winner(state)) {
+            std::cerr << "Bitboard conversion lost state in game " << g << std::endl;
+            return false;
+        }
+    }
+
+    // Policy actions feed the stats, so any difference there shows up here
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        if (scalarStats.hurdlesPlaced[t] != boardStats.hurdlesPlaced[t]) {
+            std::cerr << "Bitboard placed different hurdles" << std::endl;
+            return false;
+        }
+    }
+    for (int i = 0; i < itemTypeCount; i++) {
+        if (scalarStats.itemsBought[i] != boardStats.itemsBought[i]) {
+            std::cerr << "Bitboard bought different items" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameGame(const GameState& a, const GameState& b) {
+    return sameState(a, b);
+}
+
+static bool sameGame(const BitboardState& a, const BitboardState& b) {
+    return sameBoard(a, b);
+}
+
+// Plays game `g` once stepping every seat in turn and once through the
+// scheduler; both must end in the same state after the same number of turns
+template <typename State>
+static bool sameScheduledGame(long long g, const BatchConfig& config, BatchStats& everyStats, BatchStats& scheduledStats) {
+    State every, scheduled;
+    newGame(every, gameSeed(config.seed, g));
+    newGame(scheduled, gameSeed(config.seed, g));
+    Rng everyRng(every.seed, 1);
+    Rng scheduledRng(scheduled.seed, 1);
+
+    int everyTurns = 0;
+    for (int player = 0; everyTurns < config.maxTurns && !every.gameOver; everyTurns++) {
+        runPolicy(every, player, config, everyRng, everyStats);
+        record(step(every, Action::move(player)), everyStats);
+        player = (player + 1) % playerCount;
+    }
+
+    TurnScheduler scheduler(scheduled);
+    while (!scheduled.gameOver) {
+        int player = scheduler.next(scheduled, config.maxTurns);
+        if (player < 0) break;
+        runPolicy(scheduled, player, config, scheduledRng, scheduledStats);
+        StepResult result = step(scheduled, Action::move(player));
+        record(result, scheduledStats);
+        scheduler.played(scheduled, player, result);
+    }
+    scheduler.settle(scheduled);
+
+    if (scheduler.turnsPlayed() != everyTurns || !sameGame(every, scheduled)) {
+        std::cerr << "Turn scheduler diverged in game " << g << " (board seed " << every.seed << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool verifyScheduler(const BatchConfig& config) {
+    BatchStats everyStats, scheduledStats;
+    for (long long g = 0; g < config.games; g++) {
+        bool same = config.bitboard ? sameScheduledGame<BitboardState>(g, config, everyStats, scheduledStats)
+            : sameScheduledGame<GameState>(g, config, everyStats, scheduledStats);
+        if (!same) return false;
+    }
+
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        if (everyStats.hurdleHits[t] != scheduledStats.hurdleHits[t] ||
+            everyStats.hurdlesPlaced[t] != scheduledStats.hurdlesPlaced[t]) {
+            std::cerr << "Turn scheduler changed the hurdle counts" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool verifyReplays(const BatchConfig& config, const char* path, double& bytesPerGame) {
+    BatchStats stats;
+    GameState state, replayed;
+    BitboardState expected, actual;
+    std::vector<BitboardState> turns;
+    turns.reserve(config.maxTurns + 1);
+    long long totalBytes = 0;
+    std::string error;
+
+    for (long long g = 0; g < config.games; g++) {
+        ReplayRecorder recorder;
+        if (!recorder.open(path, gameSeed(config.seed, g), replayKeyframeInterval, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+
+        // Every seat is stepped, sat-out turns included, as the window does.
+        // turns[t] is the state just before move t + 1.
+        newGame(state, gameSeed(config.seed, g));
+        Rng rng(state.seed, 1);
+        turns.clear();
+        for (int player = 0; static_cast<int>(turns.size()) < config.maxTurns && !state.gameOver;
+            player = (player + 1) % playerCount) {
+            runPolicy(state, player, config, rng, stats, &recorder);
+            turns.emplace_back();
+            toBitboard(state, turns.back());
+            act(state, Action::move(player), stats, &recorder);
+        }
+        turns.emplace_back();
+        toBitboard(state, turns.back());
+        if (!recorder.finish()) {
+            std::cerr << path << ": cannot write replay" << std::endl;
+            return false;
+        }
+
+        ReplayFile replay;
+        if (!replay.open(path, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        totalBytes += replay.recordCount() * sizeof(ReplayRecord) + sizeof(ReplayHeader);
+
+        // Latest turn first, so each seek starts from a keyframe rather than
+        // following on from the last one
+        int turnCount = static_cast<int>(turns.size()) - 1;
+        if (replay.turnCount() != turnCount) {
+            std::cerr << "Replay of game " << g << " has " << replay.turnCount() << " turns instead of " << turnCount << std::endl;
+            return false;
+        }
+        for (int t = turnCount; t >= 0; t--) {
+            if (!seekReplay(replay, t, replayed)) {
+                std::cerr << "Replay of game " << g << " (board seed " << state.seed << ") refused a record before turn " << t << std::endl;
+                return false;
+            }
+            toBitboard(replayed, actual);
+            if (!sameBoard(actual, turns[t])) {
+                std::cerr << "Replay of game " << g << " (board seed " << state.seed << ") diverged at turn " << t << std::endl;
+                return false;
+            }
+        }
+    }
+    bytesPerGame = config.games > 0 ? static_cast<double>(totalBytes) / config.games : 0.0;
+    return true;
+}
+
+static bool samePacked(const GameState& a, const GameState& b) {
+    Snapshot x, y;
+    packSnapshot(a, x);
+    packSnapshot(b, y);
+    return std::memcmp(&x, &y, sizeof(Snapshot)) == 0;
+}
+
+bool verifySnapshots(const BatchConfig& config, const char* path, double& restoreNanos) {
+    BatchStats stats;
+    std::vector<GameState> positions;
+    GameState state;
+
+    for (long long g = 0; g < config.games; g++) {
+        newGame(state, gameSeed(config.seed, g));
+        Rng rng(state.seed, 1);
+        positions.push_back(state);
+        for (int turn = 0, player = 0; turn < config.maxTurns && !state.gameOver; turn++, player = (player + 1) % playerCount) {
+            runPolicy(state, player, config, rng, stats);
+            record(step(state, Action::move(player)), stats);
+            positions.push_back(state);
+        }
+    }
+
+    std::string error;
+    SnapshotArchive archive;
+    if (!saveSnapshots(path, positions.data(), static_cast<int>(positions.size()), error) || !archive.open(path, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+    if (archive.count() != static_cast<int>(positions.size())) {
+        std::cerr << path << " holds " << archive.count() << " snapshots instead of " << positions.size() << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < archive.count(); i++) {
+        unpackSnapshot(archive.at(i), state);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    restoreNanos = archive.count() > 0 ? elapsed.count() / archive.count() : 0.0;
+
+    // Each restored position has to pack to the same bytes and then play
+    // on exactly like the original, shopping and placing hurdles included
+    GameState original;
+    for (int i = 0; i < archive.count(); i++) {
+        if (!unpackSnapshot(archive.at(i), state) || !samePacked(state, positions[i])) {
+            std::cerr << "Snapshot " << i << " (board seed " << positions[i].seed << ") does not restore" << std::endl;
+            return false;
+        }
+        original = positions[i];
+        Rng originalRng(state.seed, 2);
+        Rng restoredRng = originalRng;
+        for (int turn = 0, player = 0; turn < config.maxTurns && !original.gameOver; turn++, player = (player + 1) % playerCount) {
+            runPolicy(original, player, config, originalRng, stats);
+            runPolicy(state, player, config, restoredRng, stats);
+            step(original, Action::move(player));
+            step(state, Action::move(player));
+            if (!samePacked(state, original)) {
+                std::cerr << "Snapshot " << i << " (board seed " << positions[i].seed << ") plays on differently" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool verifyUndo(const BatchConfig& config, int capacity, double& stepNanos) {
+    BatchStats stats;
+    UndoHistory history(capacity);
+    std::vector<GameState> positions;
+    positions.reserve(2 * static_cast<size_t>(config.maxTurns) + 1);
+    GameState state;
+    double nanos = 0;
+    long long steps = 0;
+
+    for (long long g = 0; g < config.games; g++) {
+        AllocScope scope;
+        newGame(state, gameSeed(config.seed, g));
+        Rng rng(state.seed, 1);
+        history.reset(state);
+        positions.clear();
+        positions.push_back(state);
+
+        // The policy's shopping and the move are a step each, and every
+        // move is first previewed and taken back
+        for (int turn = 0, player = 0; turn < config.maxTurns && !state.gameOver; turn++, player = (player + 1) % playerCount) {
+            runPolicy(state, player, config, rng, stats);
+            history.record(state);
+            positions.push_back(state);
+
+            step(state, Action::move(player));
+            history.rollback(state);
+            if (!samePacked(state, positions.back())) {
+                std::cerr << "Game " << g << " (board seed " << state.seed << ") does not roll back turn " << turn << std::endl;
+                return false;
+            }
+            record(step(state, Action::move(player)), stats);
+            history.record(state);
+            positions.push_back(state);
+        }
+
+        // All the way back as far as the ring reaches, then forward again
+        int last = static_cast<int>(positions.size()) - 1;
+        int reach = std::min(last, history.capacity());
+        for (int k = 1; k <= reach; k++) {
+            if (!history.undo(state) || !samePacked(state, positions[last - k])) {
+                std::cerr << "Game " << g << " (board seed " << positions[0].seed << ") does not undo step " << last - k + 1 << std::endl;
+                return false;
+            }
+        }
+        for (int k = reach - 1; k >= 0; k--) {
+            if (!history.redo(state) || !samePacked(state, positions[last - k])) {
+                std::cerr << "Game " << g << " (board seed " << positions[0].seed << ") does not redo step " << last - k << std::endl;
+                return false;
+            }
+        }
+
+        // And once more unchecked, for the timing
+        auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < reach; k++) {
+            history.undo(state);
+        }
+        for (int k = 0; k < reach; k++) {
+            history.redo(state);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        nanos += elapsed.count();
+        steps += 2 * reach;
+
+        if (history.undoSteps() != reach || history.redo(state)) {
+            std::cerr << "Game " << g << " (board seed " << positions[0].seed << ") keeps the wrong number of steps" << std::endl;
+            return false;
+        }
+        if (reach > 0) {
+            history.undo(state);
+            history.record(state);
+            if (history.redoSteps() != 0) {
+                std::cerr << "Game " << g << " (board seed " << positions[0].seed << ") can still redo after a new step" << std::endl;
+                return false;
+            }
+        }
+        if (scope.count() > 0) {
+            std::cerr << "Game " << g << " (board seed " << positions[0].seed << ") made " << scope.count() << " heap allocation(s)" << std::endl;
+            return false;
+        }
+    }
+    stepNanos = steps > 0 ? nanos / steps : 0.0;
+    return true;
+}
+
+// The value below which `fraction` of the samples lie
+static double percentile(std::vector<double>& samples, double fraction) {
+    if (samples.empty()) return 0.0;
+    size_t rank = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+static double average(const std::vector<double>& samples) {
+    double total = 0;
+    for (double sample : samples) total += sample;
+    return samples.empty() ? 0.0 : total / samples.size();
+}
+
+// The host's side of verifyNetPlay(): plays every seat but the last with
+// the policy and publishes once they have all moved, which tells the
+// remote player its turn has come
+static void hostNetGames(const BatchConfig& config, NetHost& host, std::vector<double>& processMicros, long long& turns,
+    std::string& failure) {
+    BatchStats stats;
+    GameState state;
+    Action action;
+    bool joined = false;
+    for (long long g = 0; g < config.games && failure.empty(); g++) {
+        newGame(state, gameSeed(config.seed, g));
+        Rng rng(state.seed, 1);
+        for (int turn = 0, player = 0; turn < config.maxTurns && !state.gameOver && failure.empty();
+            turn++, player = (player + 1) % playerCount) {
+            turns++;
+            if (player != host.seat()) {
+                runPolicy(state, player, config, rng, stats);
+                record(step(state, Action::move(player)), stats);
+                continue;
+            }
+
+            host.publish(state);
+            bool moved = false;
+            while (!moved) {
+                if (!host.poll(state, action)) {
+                    if (host.connected()) joined = true;
+                    else if (joined) failure = "the remote player went away";
+                    if (failure.empty() && !host.waitForInput(5000)) failure = "the remote player stopped answering";
+                    if (!failure.empty()) break;
+                    continue;
+                }
+                joined = true;
+                auto start = std::chrono::steady_clock::now();
+                StepResult result = step(state, action);
+                if (result.ok()) host.publish(state);
+                else host.reject(result.error);
+                std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+                processMicros.push_back(elapsed.count());
+                moved = result.ok() && action.type == ACTION_MOVE;
+            }
+        }
+    }
+    host.close();
+}
+
+// The remote player's side: on its turn it may buy an item or place a
+// hurdle, which the host can refuse, then moves, waiting for the answer
+// to each
+static bool playRemote(NetClient& client, GameState& state, const BatchConfig& config, std::vector<double>& roundTripMicros,
+    std::string& failure) {
+    Rng rng(config.seed, 2);
+    bool myTurn = true;     // connect() already took in the first position
+    while (true) {
+        if (!myTurn) {
+            NetUpdate update = client.poll(state);
+            if (update == NET_DISCONNECTED) return true;
+            if (update == NET_STATE) myTurn = true;
+            else if (update == NET_IDLE && !client.waitForInput(5000)) {
+                failure = "the host stopped sending";
+                return false;
+            }
+            continue;
+        }
+
+        myTurn = false;
+        int seat = client.seat();
+        Action actions[3];
+        int count = 0;
+        if (rng.below(4) == 0) actions[count++] = Action::buyItem(seat, static_cast<ItemType>(rng.below(itemTypeCount)));
+        if (rng.below(8) == 0) {
+            actions[count++] = Action::placeHurdle(seat, static_cast<HurdleType>(rng.below(hurdleTypeCount)),
+                rng.below(gridSize), rng.below(gridSize));
+        }
+        actions[count++] = Action::move(seat);
+
+        for (int i = 0; i < count; i++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!client.send(actions[i])) {
+                failure = client.error();
+                return false;
+            }
+            NetUpdate update = NET_IDLE;
+            while (update == NET_IDLE) {
+                update = client.poll(state);
+                if (update == NET_IDLE && !client.waitForInput(5000)) {
+                    failure = "the host did not answer an action";
+                    return false;
+                }
+            }
+            if (update == NET_DISCONNECTED) {
+                failure = client.error();
+                return false;
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            roundTripMicros.push_back(elapsed.count());
+        }
+    }
+}
+
+bool verifyNetPlay(const BatchConfig& config, NetCheckResult& result) {
+    NetHost host;
+    std::string error;
+    if (!host.open(0, playerCount - 1, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    std::vector<double> processMicros, roundTripMicros;
+    long long turns = 0;
+    std::string hostFailure;
+    std::thread hostThread([&]() {
+        hostNetGames(config, host, processMicros, turns, hostFailure);
+    });
+
+    NetClient client;
+    GameState state;
+    std::string clientFailure;
+    bool ok = client.connect("127.0.0.1", host.port(), state, clientFailure) &&
+        playRemote(client, state, config, roundTripMicros, clientFailure);
+    if (!ok) {
+        // Closing our end lets a waiting host give up
+        client.close();
+    }
+    hostThread.join();
+
+    if (!hostFailure.empty() || !clientFailure.empty()) {
+        std::cerr << "Network game failed: " << (hostFailure.empty() ? clientFailure : hostFailure) << std::endl;
+        return false;
+    }
+    if (client.resyncs() > 0) {
+        std::cerr << client.resyncs() << " delta(s) did not match the host's checksum" << std::endl;
+        return false;
+    }
+
+    result.actions = static_cast<long long>(processMicros.size());
+    result.processMicros = average(processMicros);
+    result.processP99Micros = percentile(processMicros, 0.99);
+    result.roundTripMicros = average(roundTripMicros);
+    result.roundTripP99Micros = percentile(roundTripMicros, 0.99);
+    result.bytesPerTurn = turns > 0 ? static_cast<double>(host.bytesSent()) / turns : 0.0;
+    return true;
+}
+
+// The audience of verifySpectators(): connects its viewers, the second
+// half once `played` reaches half the games, and follows them all until
+// the match is `finished` and every viewer shows `final`
+static void watchGames(const BatchConfig& config, uint16_t port, int viewerCount, const std::atomic<long long>& played,
+    const std::atomic<bool>& finished, const Snapshot& final, std::string& failure) {
+    std::vector<NetClient> viewers(viewerCount);
+    std::vector<GameState> states(viewerCount);
+    int joined = 0;
+    auto join = [&](int upTo) {
+        for (; joined < upTo; joined++) {
+            if (!viewers[joined].connect("127.0.0.1", port, states[joined], failure)) return false;
+            if (viewers[joined].seat() != netSpectatorSeat) {
+                failure = "a viewer was not greeted as a spectator";
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!join(viewerCount / 2)) return;
+
+    std::chrono::steady_clock::time_point doneAt;
+    bool done = false;
+    while (true) {
+        if (joined < viewerCount && played >= config.games / 2 && !join(viewerCount)) return;
+
+        bool heard = false;
+        for (int v = 0; v < joined; v++) {
+            NetUpdate update;
+            while ((update = viewers[v].poll(states[v])) != NET_IDLE) {
+                if (update == NET_DISCONNECTED) {
+                    failure = "viewer " + std::to_string(v) + " was dropped: " + viewers[v].error();
+                    return;
+                }
+                heard = true;
+            }
+            if (viewers[v].resyncs() > 0) {
+                failure = "viewer " + std::to_string(v) + " received a delta that did not match its checksum";
+                return;
+            }
+        }
+        if (heard) continue;
+
+        if (!done && finished) {
+            done = true;
+            doneAt = std::chrono::steady_clock::now();
+        }
+        if (done) {
+            bool caughtUp = joined == viewerCount;
+            Snapshot shown;
+            for (int v = 0; v < joined && caughtUp; v++) {
+                packSnapshot(states[v], shown);
+                caughtUp = std::memcmp(&shown, &final, sizeof(shown)) == 0;
+            }
+            if (caughtUp) return;
+            if (std::chrono::steady_clock::now() - doneAt > std::chrono::seconds(5)) {
+                failure = "a viewer never caught up with the final position";
+                return;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool verifySpectators(const BatchConfig& config, int viewers, SpectatorCheckResult& result) {
+    SpectatorFeed feed;
+    std::string error;
+    if (!feed.open(0, error, viewers)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    GameState state;
+    newGame(state, gameSeed(config.seed, 0));
+    feed.publish(state);
+
+    std::atomic<long long> played(0);
+    std::atomic<bool> finished(false);
+    Snapshot final;
+    std::string failure;
+    std::thread audience([&]() {
+        watchGames(config, feed.port(), viewers, played, finished, final, failure);
+    });
+
+    // Wait for the first half of the audience, so they see every move
+    for (auto waited = std::chrono::steady_clock::now();
+        feed.viewers() < viewers / 2 && std::chrono::steady_clock::now() - waited < std::chrono::seconds(10);) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Played at a live pace, so the viewers see each move rather than
+    // skipping ahead; a window game publishes far less often still
+    const auto turnPace = std::chrono::microseconds(200);
+    auto nextTurn = std::chrono::steady_clock::now();
+
+    BatchStats stats;
+    std::vector<double> publishNanos;
+    for (long long g = 0; g < config.games; g++) {
+        if (g > 0) newGame(state, gameSeed(config.seed, g));
+        Rng rng(state.seed, 1);
+        TurnScheduler scheduler(state);
+        while (!state.gameOver) {
+            int player = scheduler.next(state, config.maxTurns);
+            if (player < 0) break;
+            runPolicy(state, player, config, rng, stats);
+            StepResult stepped = step(state, Action::move(player));
+            scheduler.played(state, player, stepped);
+
+            auto start = std::chrono::steady_clock::now();
+            feed.publish(state);
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            publishNanos.push_back(elapsed.count());
+
+            nextTurn += turnPace;
+            std::this_thread::sleep_until(nextTurn);
+        }
+        played++;
+    }
+    packSnapshot(state, final);
+    finished = true;
+    audience.join();
+
+    feed.close();
+    result.frames = feed.framesPublished();
+    result.fanOutBytes = static_cast<double>(feed.bytesSent());
+    if (!failure.empty()) {
+        std::cerr << "Spectator check failed: " << failure << std::endl;
+        return false;
+    }
+    result.publishNanos = average(publishNanos);
+    result.publishP99Nanos = percentile(publishNanos, 0.99);
+    result.bytesPerFrame = result.frames > 0 ? static_cast<double>(feed.bytesPublished()) / result.frames : 0.0;
+    return true;
+}
+
+bool verifyNoAllocations(const BatchConfig& config) {
+    if (!AllocTracker::enabled()) {
+        std::cerr << "Allocation tracking is not compiled in; rebuild with -DAQ_TRACK_ALLOCATIONS" << std::endl;
+        return false;
+    }
+
+    BatchStats stats;
+    for (long long i = 0; i < config.games; i++) {
+        AllocScope scope;
+        if (config.bitboard) playGame<BitboardState>(i, config, stats);
+        else playGame<GameState>(i, config, stats);
+        if (scope.count() > 0) {
+            std::cerr << "Game " << i << " (board seed " << gameSeed(config.seed, i) << ") made "
+                << scope.count() << " heap allocation(s)" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static double percent(long long part, long long whole) {
+    return whole > 0 ? 100.0 * part / whole : 0.0;
+}
+
+void printStats(const BatchStats& stats, double seconds) {
+    std::cout << "Games played:     " << stats.games << " in " << seconds << "s";
+    if (seconds > 0) std::cout << " (" << static_cast<long long>(stats.games / seconds) << " games/s)";
+    std::cout << std::endl;
+
+    for (int p = 0; p < playerCount; p++) {
+        std::cout << "Player " << p + 1 << " wins:   " << stats.wins[p] << " (" << percent(stats.wins[p], stats.games) << "%)" << std::endl;
+    }
+    std::cout << "Ties:             " << stats.ties << " (" << percent(stats.ties, stats.games) << "%)" << std::endl;
+    std::cout << "Unfinished:       " << stats.unfinished << std::endl;
+
+    std::cout << "Game length:      avg " << (stats.games ? static_cast<double>(stats.totalTurns) / stats.games : 0.0)
+        << " turns, min " << stats.shortestGame << ", max " << stats.longestGame << std::endl;
+
+    std::cout << "Hurdles (hit / blocked / placed per game):" << std::endl;
+    for (int h = 0; h < hurdleTypeCount; h++) {
+        double games = stats.games ? static_cast<double>(stats.games) : 1.0;
+        std::cout << "  " << hurdleNames[h] << ": " << stats.hurdleHits[h] / games << " / "
+            << stats.hurdleBlocks[h] / games << " / " << stats.hurdlesPlaced[h] / games << std::endl;
+    }
+
+    std::cout << "Items bought per game:";
+    for (int i = 0; i < itemTypeCount; i++) {
+        std::cout << " " << itemNames[i] << " " << (stats.games ? static_cast<double>(stats.itemsBought[i]) / stats.games : 0.0);
+    }
+    std::cout << std::endl;
+
+    std::cout << "Coin pickup rate: gold " << percent(stats.coinsCollected[GOLD], stats.coinsOnBoard[GOLD])
+        << "%, silver " << percent(stats.coinsCollected[SILVER], stats.coinsOnBoard[SILVER]) << "%" << std::endl;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "GameEngine.h"
+
+// Plays many complete matches without a window and collects aggregate
+// statistics. Games are spread over worker threads that steal work from
+// each other when they run dry.
+
+enum PolicyKind {
+    POLICY_RANDOM,      // random purchases and hurdle placements
+    POLICY_SCRIPTED,    // keeps one of every item, blocks the opponent's path
+    POLICY_MOVE_ONLY    // never shops; the only policy the vectorized kernel runs
+};
+
+struct BatchConfig {
+    long long games;
+    int threads;        // 0 = one per hardware thread
+    PolicyKind policy;
+    int maxTurns;       // games still running after this many turns are abandoned
+    uint64_t seed;      // every game's board is derived from this and its index
+    bool vectorized;    // play move-only games simdLanes at a time (SimdBatch.h)
+    bool bitboard;      // play on BitboardState instead of GameState (Bitboard.h)
+
+    BatchConfig() : games(100000), threads(0), policy(POLICY_RANDOM), maxTurns(1000), seed(1), vectorized(false),
+        bitboard(false) {}
+};
+
+struct BatchStats {
+    long long games;
+    long long wins[playerCount];
+    long long ties;
+    long long unfinished;
+    long long totalTurns;
+    int shortestGame;
+    int longestGame;
+    long long hurdleHits[hurdleTypeCount];
+    long long hurdleBlocks[hurdleTypeCount];
+    long long hurdlesPlaced[hurdleTypeCount];
+    long long itemsBought[itemTypeCount];
+    long long coinsCollected[2];    // indexed by CoinType
+    long long coinsOnBoard[2];
+
+    BatchStats();
+    void merge(const BatchStats& other);
+};
+
+BatchStats runBatch(const BatchConfig& config);
+
+// Plays the same move-only games through step() and through the vectorized
+// kernel and compares every lane after every move. Returns false and
+// reports the first difference.
+bool verifyVectorized(long long games, int maxTurns, uint64_t seed);
+
+// Plays the configured games on GameState and BitboardState side by side
+// and compares them after every action. Returns false and reports the
+// first difference.
+bool verifyBitboard(const BatchConfig& config);
+
+// Plays the configured games once stepping every seat in turn, sat-out
+// turns included, and once through TurnScheduler (Turns.h), and compares
+// the final states. Returns false and reports the first difference.
+bool verifyScheduler(const BatchConfig& config);
+
+// Records the configured games to `path` one at a time, stepping every
+// seat as the window does, then maps each replay and checks that seeking
+// to every turn rebuilds the state the game had there. bytesPerGame is the
+// average size without keyframes.
+bool verifyReplays(const BatchConfig& config, const char* path, double& bytesPerGame);
+
+// Saves every position of the configured games to `path` as one snapshot
+// archive, maps it back and checks that each restores to the same
+// position and plays on identically. restoreNanos is the average time to
+// restore one snapshot from the mapped file.
+bool verifySnapshots(const BatchConfig& config, const char* path, double& restoreNanos);
+
+// Plays every game keeping its positions in an UndoHistory of `capacity`
+// steps, previewing and taking back each move, then undoes as far as the
+// history reaches and redoes back, checking every position on the way.
+// In a -DAQ_TRACK_ALLOCATIONS build it also fails on any heap allocation.
+// stepNanos is the average time of one undo or redo.
+bool verifyUndo(const BatchConfig& config, int capacity, double& stepNanos);
+
+// What verifyNetPlay() measured
+struct NetCheckResult {
+    long long actions;          // remote actions the host handled
+    double processMicros;       // host time from receiving an action to sending its result
+    double processP99Micros;
+    double roundTripMicros;     // remote player's wait from sending an action to the answer
+    double roundTripP99Micros;
+    double bytesPerTurn;        // host to remote player, every seat's turn counted
+};
+
+// Plays the configured games as a two-machine match over loopback TCP:
+// a host thread plays every seat but the last and a remote player thread
+// takes that one through NetClient, with every delta checked against the
+// host's checksum. Fails on any desync or dropped connection.
+bool verifyNetPlay(const BatchConfig& config, NetCheckResult& result);
+
+// What verifySpectators() measured
+struct SpectatorCheckResult {
+    long long frames;           // changes published
+    double bytesPerFrame;       // published once, whatever the audience
+    double publishNanos;        // the match's time per publish() with everyone watching
+    double publishP99Nanos;
+    double fanOutBytes;         // bytes written to all viewers together
+};
+
+// Plays the configured games while `viewers` local NetClients watch them
+// through a SpectatorFeed over loopback, one turn every 200 us. Half join before the first move
+// and half while the games are under way. Fails if any viewer drops,
+// needs a resync or ends on a different position than the match.
+bool verifySpectators(const BatchConfig& config, int viewers, SpectatorCheckResult& result);
+
+// Plays the configured games on one thread and fails if any of them made a
+// heap allocation. Needs a build with -DAQ_TRACK_ALLOCATIONS (AllocTracker.h).
+bool verifyNoAllocations(const BatchConfig& config);
+
+// Board seed of game `gameIndex` in a batch run with `batchSeed`
+uint64_t gameSeed(uint64_t batchSeed, long long gameIndex);
+
+void printStats(const BatchStats& stats, double seconds);
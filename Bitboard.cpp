@@ -0,0 +1,429 @@
+#include "Bitboard.h"
+#include "Catalog.h"
+
+namespace {
+
+// Cell bit of every path position, from the same tables PlayerState uses
+struct PathMasks {
+    CellMask cells[playerCount][pathLen];
+    CellMask goal;
+    CellMask startOrGoal;
+
+    PathMasks() : goal(CellMask::cell(Board::goalCell)), startOrGoal(CellMask::none()) {
+        for (int p = 0; p < playerCount; p++) {
+            for (int i = 0; i < pathLen; i++) {
+                cells[p][i] = CellMask::cell(Board::pathCell(p, i));
+            }
+            startOrGoal |= cells[p][0];
+        }
+        startOrGoal |= goal;
+    }
+};
+
+const PathMasks paths;
+
+CellMask playerCell(const BitboardState& board, int player) {
+    return paths.cells[player][board.players[player].pos];
+}
+
+CellMask liveHurdles(const BitboardState& board) {
+    CellMask live = CellMask::none();
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        live |= board.hurdleCells[t];
+    }
+    return live;
+}
+
+int hurdleTypeAt(const BitboardState& board, CellMask bit) {
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        if (board.hurdleCells[t] & bit) return t;
+    }
+    return -1;
+}
+
+int slotAt(const BitboardState& board, CellMask bit) {
+    int slot = 0;
+    for (int k = 0; k < slotPlaneCount; k++) {
+        if (board.slotPlanes[k] & bit) slot |= 1 << k;
+    }
+    return slot;
+}
+
+// The live hurdle in `slot`, or an empty mask
+CellMask slotCell(const BitboardState& board, int slot) {
+    CellMask cells = liveHurdles(board);
+    for (int k = 0; k < slotPlaneCount; k++) {
+        cells &= (slot >> k & 1) ? board.slotPlanes[k] : ~board.slotPlanes[k];
+    }
+    return cells;
+}
+
+void clearHurdle(BitboardState& board, CellMask bit) {
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        board.hurdleCells[t] &= ~bit;
+    }
+    for (int k = 0; k < slotPlaneCount; k++) {
+        board.slotPlanes[k] &= ~bit;
+    }
+}
+
+void setHurdle(BitboardState& board, CellMask bit, int type, int slot) {
+    board.hurdleCells[type] |= bit;
+    for (int k = 0; k < slotPlaneCount; k++) {
+        if (slot >> k & 1) board.slotPlanes[k] |= bit;
+    }
+}
+
+// Pool::acquire() on the bitboard's copy of the free list
+int acquireSlot(BitboardState& board) {
+    if (board.freeSlotCount > 0) return board.freeSlots[--board.freeSlotCount];
+    if (board.slotsUsed < entityCapacity) return board.slotsUsed++;
+    return -1;
+}
+
+PlayerState toPlayerState(const BitPlayer& from, int index) {
+    PlayerState to(index);
+    to.pos = from.pos;
+    to.skipTurns = from.skipTurns;
+    to.goldCoins = from.goldCoins;
+    to.silverCoins = from.silverCoins;
+    to.score = from.score;
+    for (int i = 0; i < itemTypeCount; i++) {
+        to.items[i] = from.items[i];
+    }
+    to.atGoal = from.atGoal;
+    return to;
+}
+
+BitPlayer toBitPlayer(const PlayerState& from) {
+    BitPlayer to;
+    to.goldCoins = static_cast<int16_t>(from.goldCoins);
+    to.silverCoins = static_cast<int16_t>(from.silverCoins);
+    to.score = static_cast<int16_t>(from.score);
+    to.pos = static_cast<uint16_t>(from.pos);
+    to.skipTurns = static_cast<uint8_t>(from.skipTurns);
+    for (int i = 0; i < itemTypeCount; i++) {
+        to.items[i] = static_cast<uint8_t>(from.items[i]);
+    }
+    to.atGoal = from.atGoal;
+    return to;
+}
+
+void hitHurdle(BitboardState& board, int index, CellMask bit, int slot, StepResult& result) {
+    BitPlayer& player = board.players[index];
+    int type = hurdleTypeAt(board, bit);
+    const HurdleRule& rule = rules().hurdles[type];
+    uint8_t& item = player.items[rule.counter];
+
+    if (item > 0) {
+        item--;
+        result.addEvent(EVENT_HURDLE_BLOCKED, index, type);
+    }
+    else {
+        player.skipTurns = static_cast<uint8_t>(rule.skipTurns);
+        if (rule.pushback > 0 && player.pos >= rule.pushback) player.pos -= rule.pushback;
+        result.addEvent(EVENT_HURDLE_HIT, index, type);
+    }
+    clearHurdle(board, bit);
+    board.freeSlots[board.freeSlotCount++] = static_cast<HurdleSlot>(slot);
+}
+
+// Marks the players standing on `bit` for the next collision check
+void markPlayersOn(BitboardState& board, CellMask bit) {
+    for (int p = 0; p < playerCount; p++) {
+        if (playerCell(board, p) == bit) {
+            board.pendingPlayers |= uint32_t(1) << p;
+        }
+    }
+}
+
+void checkCollisions(BitboardState& board, StepResult& result) {
+    // The lowest-numbered player on a coin's cell takes it
+    for (int p = 0; p < playerCount; p++) {
+        CellMask bit = playerCell(board, p);
+        if (!(board.coinCells & bit)) continue;
+
+        BitPlayer& player = board.players[p];
+        if (board.goldCells & bit) {
+            player.goldCoins++;
+            player.score += GOLD_COIN_POINTS;
+            result.addEvent(EVENT_COIN_COLLECTED, p, GOLD);
+        }
+        else {
+            player.silverCoins++;
+            player.score += SILVER_COIN_POINTS;
+            result.addEvent(EVENT_COIN_COLLECTED, p, SILVER);
+        }
+        board.coinCells &= ~bit;
+        board.goldCells &= ~bit;
+    }
+
+    // Hurdles in slot order, as step() on a GameState resolves them, so a
+    // snake pushback meets a higher-numbered hurdle on the same turn
+    for (int next = 0;;) {
+        CellMask live = liveHurdles(board);
+        int found = entityCapacity;
+        CellMask foundBit = CellMask::none();
+        for (int p = 0; p < playerCount; p++) {
+            CellMask bit = playerCell(board, p);
+            if (!(live & bit)) continue;
+            int slot = slotAt(board, bit);
+            if (slot >= next && slot < found) {
+                found = slot;
+                foundBit = bit;
+            }
+        }
+        if (found == entityCapacity) break;
+
+        for (int p = 0; p < playerCount; p++) {
+            if (playerCell(board, p) == foundBit) {
+                hitHurdle(board, p, foundBit, found, result);
+                break;
+            }
+        }
+        next = found + 1;
+    }
+
+    CellMask occupied = board.coinCells | liveHurdles(board);
+    board.pendingPlayers = 0;
+    for (int p = 0; p < playerCount; p++) {
+        if (occupied & playerCell(board, p)) {
+            board.pendingPlayers |= uint32_t(1) << p;
+        }
+        if (board.players[p].atGoal) {
+            board.gameOver = true;
+        }
+    }
+}
+
+StepError placeHurdle(BitboardState& board, const Action& action, StepResult& result) {
+    if (action.x < 0 || action.x >= gridSize || action.y < 0 || action.y >= gridSize) {
+        return STEP_INVALID_CELL;
+    }
+
+    CellMask bit = cellBit(action.x, action.y);
+    if (paths.startOrGoal & bit) return STEP_START_OR_GOAL;
+    if (board.coinCells & bit) return STEP_CELL_HAS_COIN;
+    if (liveHurdles(board) & bit) return STEP_CELL_HAS_HURDLE;
+    if (board.freeSlotCount == 0 && board.slotsUsed == entityCapacity) return STEP_BOARD_FULL;
+
+    // Purchases go through PlayerState so prices and change-making stay in one place
+    PlayerState buyer = toPlayerState(board.players[action.player], action.player);
+    if (!buyer.buyHurdle(static_cast<HurdleType>(action.item))) {
+        return STEP_NOT_ENOUGH_COINS;
+    }
+    board.players[action.player] = toBitPlayer(buyer);
+
+    setHurdle(board, bit, action.item, acquireSlot(board));
+    markPlayersOn(board, bit);
+
+    result.addEvent(EVENT_HURDLE_PLACED, action.player, action.item);
+    return STEP_OK;
+}
+
+}
+
+void toBitboard(const GameState& state, BitboardState& board) {
+    for (int p = 0; p < playerCount; p++) {
+        board.players[p] = toBitPlayer(state.players[p]);
+    }
+
+    board.coinCells = CellMask::none();
+    board.goldCells = CellMask::none();
+    for (int c = 0; c < state.coins.end(); c++) {
+        if (!state.coins.isLive(c)) continue;
+        CellMask bit = CellMask::cell(state.coins.cell[c]);
+        board.coinCells |= bit;
+        if (state.coins.type[c] == GOLD) board.goldCells |= bit;
+    }
+
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        board.hurdleCells[t] = CellMask::none();
+    }
+    for (int k = 0; k < slotPlaneCount; k++) {
+        board.slotPlanes[k] = CellMask::none();
+    }
+    for (int h = 0; h < state.hurdles.end(); h++) {
+        if (state.hurdles.isLive(h)) {
+            setHurdle(board, CellMask::cell(state.hurdles.cell[h]), state.hurdles.type[h], h);
+        }
+    }
+    const SlotPool<entityCapacity>& slots = state.hurdles.slots;
+    board.slotsUsed = static_cast<HurdleSlot>(slots.end());
+    board.freeSlotCount = static_cast<HurdleSlot>(slots.freeSlotCount());
+    for (int i = 0; i < entityCapacity; i++) {
+        board.freeSlots[i] = i < board.freeSlotCount ? static_cast<HurdleSlot>(slots.freeSlot(i)) : 0;
+    }
+
+    board.currentPlayer = static_cast<uint8_t>(state.currentPlayer);
+    board.gameOver = state.gameOver;
+    board.pendingPlayers = state.pendingPlayers;
+    board.seed = state.seed;
+    board.rng = state.rng;
+}
+
+void fromBitboard(const BitboardState& board, GameState& state) {
+    state = GameState();
+    for (int p = 0; p < playerCount; p++) {
+        state.players[p] = toPlayerState(board.players[p], p);
+    }
+
+    for (int cell = 0; cell < Board::cellCount; cell++) {
+        CellMask bit = CellMask::cell(cell);
+        if (!(board.coinCells & bit)) continue;
+        state.coins.add(cell, (board.goldCells & bit) ? GOLD : SILVER);
+    }
+
+    // Hand out every slot ever used, then free the dead ones in the
+    // recorded order so the next placement picks the same slot
+    for (int h = 0; h < board.slotsUsed; h++) {
+        CellMask bit = slotCell(board, h);
+        if (bit) state.hurdles.add(bit.first(), hurdleTypeAt(board, bit));
+        else state.hurdles.add(0, 0);
+    }
+    for (int i = 0; i < board.freeSlotCount; i++) {
+        state.hurdles.remove(board.freeSlots[i]);
+    }
+
+    state.currentPlayer = board.currentPlayer;
+    state.gameOver = board.gameOver;
+    state.seed = board.seed;
+    state.rng = board.rng;
+    rebuildOccupancy(state);
+}
+
+void newGame(BitboardState& board, uint64_t seed) {
+    GameState state;
+    newGame(state, seed);
+    toBitboard(state, board);
+}
+
+StepError spawnCoin(BitboardState& board, int x, int y, CoinType type) {
+    if (x < 0 || x >= gridSize || y < 0 || y >= gridSize) {
+        return STEP_INVALID_CELL;
+    }
+
+    CellMask bit = cellBit(x, y);
+    if (paths.startOrGoal & bit) return STEP_START_OR_GOAL;
+    if (board.coinCells & bit) return STEP_CELL_HAS_COIN;
+    if (liveHurdles(board) & bit) return STEP_CELL_HAS_HURDLE;
+    if (board.coinCells.count() == entityCapacity) return STEP_BOARD_FULL;
+
+    board.coinCells |= bit;
+    if (type == GOLD) board.goldCells |= bit;
+    markPlayersOn(board, bit);
+    return STEP_OK;
+}
+
+StepResult step(BitboardState& board, const Action& action) {
+    StepResult result;
+
+    if (board.gameOver) {
+        result.error = STEP_GAME_OVER;
+        return result;
+    }
+    if (action.player < 0 || action.player >= playerCount) {
+        result.error = STEP_BAD_ACTION;
+        return result;
+    }
+
+    BitPlayer& player = board.players[action.player];
+
+    switch (action.type) {
+    case ACTION_MOVE:
+        board.currentPlayer = static_cast<uint8_t>(action.player);
+        if (player.skipTurns > 0) {
+            player.skipTurns--;
+            result.addEvent(EVENT_TURN_SKIPPED, action.player);
+        }
+        else if (player.pos + 1 < pathLen) {
+            player.pos++;
+            if (paths.cells[action.player][player.pos] == paths.goal) {
+                player.atGoal = true;
+            }
+            result.addEvent(EVENT_MOVED, action.player);
+        }
+        checkCollisions(board, result);
+        if (player.atGoal) {
+            result.addEvent(EVENT_REACHED_GOAL, action.player);
+        }
+        break;
+
+    case ACTION_BUY_ITEM:
+        if (action.item < 0 || action.item >= itemTypeCount) {
+            result.error = STEP_BAD_ACTION;
+            break;
+        }
+        {
+            PlayerState buyer = toPlayerState(player, action.player);
+            if (buyer.buyItem(static_cast<ItemType>(action.item))) {
+                player = toBitPlayer(buyer);
+                result.addEvent(EVENT_ITEM_BOUGHT, action.player, action.item);
+            }
+            else {
+                result.error = STEP_NOT_ENOUGH_COINS;
+            }
+        }
+        break;
+
+    case ACTION_PLACE_HURDLE:
+        if (action.item < 0 || action.item >= hurdleTypeCount) {
+            result.error = STEP_BAD_ACTION;
+        }
+        else {
+            result.error = placeHurdle(board, action, result);
+        }
+        break;
+
+    default:
+        result.error = STEP_BAD_ACTION;
+        break;
+    }
+
+    return result;
+}
+
+int winner(const BitboardState& board) {
+    int best = -1;
+    bool tied = false;
+    for (int p = 0; p < playerCount; p++) {
+        const BitPlayer& player = board.players[p];
+        if (!player.atGoal) continue;
+
+        // Several reached the goal, compare scores
+        if (best < 0 || player.score > board.players[best].score) {
+            best = p;
+            tied = false;
+        }
+        else if (player.score == board.players[best].score) {
+            tied = true;
+        }
+    }
+    return tied ? -1 : best;
+}
+
+bool sameBoard(const BitboardState& a, const BitboardState& b) {
+    for (int p = 0; p < playerCount; p++) {
+        const BitPlayer& x = a.players[p];
+        const BitPlayer& y = b.players[p];
+        if (x.pos != y.pos || x.skipTurns != y.skipTurns || x.goldCoins != y.goldCoins ||
+            x.silverCoins != y.silverCoins || x.score != y.score || x.atGoal != y.atGoal) {
+            return false;
+        }
+        for (int i = 0; i < itemTypeCount; i++) {
+            if (x.items[i] != y.items[i]) return false;
+        }
+    }
+    for (int t = 0; t < hurdleTypeCount; t++) {
+        if (a.hurdleCells[t] != b.hurdleCells[t]) return false;
+    }
+    for (int k = 0; k < slotPlaneCount; k++) {
+        if (a.slotPlanes[k] != b.slotPlanes[k]) return false;
+    }
+    if (a.freeSlotCount != b.freeSlotCount || a.slotsUsed != b.slotsUsed) return false;
+    for (int i = 0; i < a.freeSlotCount; i++) {
+        if (a.freeSlots[i] != b.freeSlots[i]) return false;
+    }
+    return a.coinCells == b.coinCells && a.goldCells == b.goldCells &&
+        a.currentPlayer == b.currentPlayer && a.gameOver == b.gameOver;
+}
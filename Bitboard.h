@@ -0,0 +1,152 @@
+#pragma once
+
+#include "GameEngine.h"
+
+#include <type_traits>
+
+// Compact alternative to GameState. Everything on the board is a set of
+// cells held in a bit mask, so collision checks are mask ANDs and a whole
+// 5x5 game is a few dozen bytes. step() on a BitboardState follows exactly
+// the same rules as step() on a GameState.
+
+// One bit per cell, packed into 32-bit words. The 5x5 board fits in a
+// single word; larger boards (Board.h) just use more of them.
+struct CellMask {
+    static const int wordCount = (Board::cellCount + 31) / 32;
+    uint32_t words[wordCount];
+
+    static CellMask none() {
+        CellMask mask;
+        for (int w = 0; w < wordCount; w++) mask.words[w] = 0;
+        return mask;
+    }
+
+    static CellMask cell(int index) {
+        CellMask mask = none();
+        mask.words[index / 32] = uint32_t(1) << (index % 32);
+        return mask;
+    }
+
+    explicit operator bool() const {
+        for (int w = 0; w < wordCount; w++) {
+            if (words[w]) return true;
+        }
+        return false;
+    }
+
+    // Number of cells set
+    int count() const {
+        int n = 0;
+        for (int w = 0; w < wordCount; w++) {
+            for (uint32_t bits = words[w]; bits; bits &= bits - 1) n++;
+        }
+        return n;
+    }
+
+    // Index of the lowest cell set, or -1
+    int first() const {
+        for (int w = 0; w < wordCount; w++) {
+            for (int b = 0; b < 32; b++) {
+                if (words[w] >> b & 1) return w * 32 + b;
+            }
+        }
+        return -1;
+    }
+
+    CellMask& operator&=(const CellMask& other) {
+        for (int w = 0; w < wordCount; w++) words[w] &= other.words[w];
+        return *this;
+    }
+
+    CellMask& operator|=(const CellMask& other) {
+        for (int w = 0; w < wordCount; w++) words[w] |= other.words[w];
+        return *this;
+    }
+
+    CellMask operator~() const {
+        CellMask mask;
+        for (int w = 0; w < wordCount; w++) mask.words[w] = ~words[w];
+        return mask;
+    }
+
+    CellMask operator&(const CellMask& other) const {
+        CellMask mask = *this;
+        return mask &= other;
+    }
+
+    CellMask operator|(const CellMask& other) const {
+        CellMask mask = *this;
+        return mask |= other;
+    }
+
+    bool operator==(const CellMask& other) const {
+        for (int w = 0; w < wordCount; w++) {
+            if (words[w] != other.words[w]) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const CellMask& other) const {
+        return !(*this == other);
+    }
+};
+
+inline CellMask cellBit(int x, int y) {
+    return CellMask::cell(cellIndex(x, y));
+}
+
+// Bits needed to number `slots` slots
+constexpr int slotBits(int slots) {
+    return slots <= 1 ? 0 : 1 + slotBits((slots + 1) / 2);
+}
+
+// A hurdle's slot in GameState::hurdles is kept bit-sliced across this
+// many masks; step() resolves hurdles in slot order.
+const int slotPlaneCount = slotBits(entityCapacity);
+
+static_assert(entityCapacity <= (1 << slotPlaneCount), "not enough slot planes for entityCapacity");
+
+// Smallest type that can number every hurdle slot
+typedef std::conditional<entityCapacity <= 255, uint8_t, uint16_t>::type HurdleSlot;
+
+static_assert(pathLen <= 65535, "path steps must fit BitPlayer::pos");
+
+struct BitPlayer {
+    int16_t goldCoins, silverCoins;
+    int16_t score;
+    uint16_t pos;
+    uint8_t skipTurns;
+    uint8_t items[itemTypeCount];
+    bool atGoal;
+};
+
+struct BitboardState {
+    BitPlayer players[playerCount];
+    CellMask coinCells;                     // uncollected coins
+    CellMask goldCells;                     // the gold ones among coinCells
+    CellMask hurdleCells[hurdleTypeCount];  // live hurdles, one mask per HurdleType
+    CellMask slotPlanes[slotPlaneCount];    // bit k of each live hurdle's slot
+    HurdleSlot freeSlots[entityCapacity];   // GameState::hurdles' free list, oldest first
+    HurdleSlot freeSlotCount;
+    HurdleSlot slotsUsed;                   // GameState::hurdles.end()
+    uint8_t currentPlayer;
+    bool gameOver;
+    uint32_t pendingPlayers;                // as GameState::pendingPlayers; not compared by sameBoard()
+    uint64_t seed;
+    Rng rng;
+};
+
+void toBitboard(const GameState& state, BitboardState& board);
+
+// Collected coins carry no position in a bitboard, so coins comes back
+// with the live ones in the lowest slots; everything else round-trips
+// exactly.
+void fromBitboard(const BitboardState& board, GameState& state);
+
+void newGame(BitboardState& board, uint64_t seed);
+StepError spawnCoin(BitboardState& board, int x, int y, CoinType type);
+StepResult step(BitboardState& board, const Action& action);
+int winner(const BitboardState& board);
+
+// Compares everything but the generator, like the batch runner's checks
+bool sameBoard(const BitboardState& a, const BitboardState& b);
@@ -0,0 +1,150 @@
+#pragma once
+
+// Board geometry for any odd board size and up to eight players, generated
+// at compile time. Player 1 starts in the top-right corner and snakes
+// along the rows towards the centre; every other player follows the same
+// route under one of the square's symmetries, so all paths are equally
+// long and end on the goal. Player 2 gets the half turn, as the two-player
+// game always has, players 3 and 4 the quarter turns and players 5 to 8
+// the mirror images of the first four.
+//
+// The engine plays on BoardLayout<AQ_BOARD_SIZE, AQ_PLAYER_COUNT>, a 5x5
+// board for two unless the build passes e.g. -DAQ_BOARD_SIZE=7 or
+// -DAQ_PLAYER_COUNT=4.
+
+#ifndef AQ_BOARD_SIZE
+#define AQ_BOARD_SIZE 5
+#endif
+
+#ifndef AQ_PLAYER_COUNT
+#define AQ_PLAYER_COUNT 2
+#endif
+
+const int maxBoardPlayers = 8;
+
+// Every row above the centre, then the centre row as far as the goal
+constexpr int boardPathLength(int size) {
+    return (size / 2) * size + size / 2 + 1;
+}
+
+// Distinct start corners: players 5 to 8 share corners with players 1 to 4
+constexpr int boardStartCount(int players) {
+    return players < 4 ? players : 4;
+}
+
+// Where `cell` of player 1's path lies on player `player`'s
+constexpr int symmetricCell(int size, int player, int cell) {
+    const int last = size - 1;
+    int x = cell % size;
+    int y = cell / size;
+    if (player >= 4) x = last - x;      // mirror image
+
+    int tx = x, ty = y;
+    switch (player % 4) {
+    case 1: tx = last - x; ty = last - y; break;    // half turn
+    case 2: tx = last - y; ty = x; break;           // quarter turn clockwise
+    case 3: tx = y; ty = last - x; break;           // quarter turn anticlockwise
+    default: break;
+    }
+    return ty * size + tx;
+}
+
+template <int Size, int Players>
+struct BoardTables {
+    int path[Players][boardPathLength(Size)];           // cell index of each step
+    int step[Players][Size * Size];                     // path step on each cell, or -1
+    bool startOrGoal[Size * Size];
+    int open[Size * Size - 1 - boardStartCount(Players)];   // cells that are neither a start nor the goal
+};
+
+template <int Size, int Players>
+constexpr BoardTables<Size, Players> makeBoardTables() {
+    BoardTables<Size, Players> t{};
+    for (int c = 0; c < Size * Size; c++) {
+        for (int p = 0; p < Players; p++) {
+            t.step[p][c] = -1;
+        }
+        t.startOrGoal[c] = false;
+    }
+
+    const int center = Size / 2;
+    int n = 0;
+    for (int y = 0; y <= center; y++) {
+        for (int i = 0; i < Size; i++) {
+            // Even rows run right to left, odd rows left to right
+            int x = y % 2 == 0 ? Size - 1 - i : i;
+            int cell = y * Size + x;
+
+            for (int p = 0; p < Players; p++) {
+                t.path[p][n] = symmetricCell(Size, p, cell);
+                t.step[p][t.path[p][n]] = n;
+            }
+            n++;
+
+            if (y == center && x == center) break;
+        }
+    }
+
+    for (int p = 0; p < Players; p++) {
+        t.startOrGoal[t.path[p][0]] = true;
+    }
+    t.startOrGoal[center * Size + center] = true;
+
+    int open = 0;
+    for (int c = 0; c < Size * Size; c++) {
+        if (!t.startOrGoal[c]) {
+            t.open[open++] = c;
+        }
+    }
+    return t;
+}
+
+template <int Size, int Players = 2>
+struct BoardLayout {
+    static_assert(Size >= 3 && Size % 2 == 1, "the goal sits in the centre cell, so the board size must be odd");
+    static_assert(Players >= 2 && Players <= maxBoardPlayers, "paths exist for two to eight players");
+
+    static constexpr int size = Size;
+    static constexpr int playerCount = Players;
+    static constexpr int cellCount = Size * Size;
+    static constexpr int pathLength = boardPathLength(Size);
+    static constexpr int goalCell = (Size / 2) * Size + Size / 2;
+    static constexpr int openCellCount = Size * Size - 1 - boardStartCount(Players);
+
+    static constexpr BoardTables<Size, Players> tables = makeBoardTables<Size, Players>();
+
+    // Cell index of step `step` of `player`'s path
+    static constexpr int pathCell(int player, int step) {
+        return tables.path[player][step];
+    }
+
+    // Step of `player`'s path that lies on `cell`, or -1 if it is off the path
+    static constexpr int pathStep(int player, int cell) {
+        return tables.step[player][cell];
+    }
+
+    static constexpr int startCell(int player) {
+        return tables.path[player][0];
+    }
+
+    // The `i`-th cell that coins and hurdles may be placed on
+    static constexpr int openCell(int i) {
+        return tables.open[i];
+    }
+
+    static constexpr bool isStartOrGoal(int cell) {
+        return tables.startOrGoal[cell];
+    }
+};
+
+typedef BoardLayout<AQ_BOARD_SIZE, AQ_PLAYER_COUNT> Board;
+
+// The 5x5 board the game has always used
+static_assert(BoardLayout<5>::pathLength == 13, "5x5 paths are 13 steps");
+static_assert(BoardLayout<5>::startCell(0) == 4 && BoardLayout<5>::startCell(1) == 20, "5x5 starts are (4,0) and (0,4)");
+static_assert(BoardLayout<5>::pathCell(0, 5) == 5 && BoardLayout<5>::pathCell(0, 10) == 14, "5x5 player 1 turns at (0,1) and (4,2)");
+static_assert(BoardLayout<5>::pathStep(1, BoardLayout<5>::goalCell) == 12, "both paths end on the goal");
+
+// Extra players start in the remaining corners and still finish on the goal
+static_assert(BoardLayout<5, 4>::startCell(2) == 24 && BoardLayout<5, 4>::startCell(3) == 0, "players 3 and 4 start at (4,4) and (0,0)");
+static_assert(BoardLayout<5, 8>::pathStep(7, BoardLayout<5, 8>::goalCell) == 12, "mirrored paths end on the goal");
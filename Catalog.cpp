@@ -0,0 +1,193 @@
+#include "Catalog.h"
+#include "Payment.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const Catalog builtInCatalog = {
+    {
+        { SWORD_COST, PAY_ANY },
+        { SHIELD_COST, PAY_ANY },
+        { WATER_COST, PAY_ANY },
+        { KEY_COST, PAY_ANY }
+    },
+    {
+        { FIRE_COST, PAY_ANY, WATER, 2, 0 },
+        { SNAKE_COST, PAY_ANY, SWORD, 3, 3 },
+        { GHOST_COST, PAY_ANY, SHIELD, 1, 0 },
+        { LION_COST, PAY_GOLD, SWORD, 4, 0 },
+        { LOCK_COST, PAY_SILVER, KEY, 5, 0 }
+    }
+};
+
+const int maxCost = 500;    // keeps the payment tables small
+
+int findName(const char* const* names, int count, const std::string& name) {
+    for (int i = 0; i < count; i++) {
+        if (name == names[i]) return i;
+    }
+    return -1;
+}
+
+// Checks a price can actually be paid in the required coins
+bool validCost(int cost, Currency currency) {
+    if (cost <= 0 || cost > maxCost) return false;
+    if (currency == PAY_GOLD) return cost % GOLD_COIN_POINTS == 0;
+    if (currency == PAY_SILVER) return cost % SILVER_COIN_POINTS == 0;
+    return true;
+}
+
+}
+
+const char* const currencyNames[3] = { "any", "gold", "silver" };
+
+Catalog activeRules = builtInCatalog;
+
+const Catalog& defaultCatalog() {
+    return builtInCatalog;
+}
+
+void setRules(const Catalog& catalog) {
+    activeRules = catalog;
+    activePayments.build(catalog);
+}
+
+uint64_t catalogHash(const Catalog& catalog) {
+    // FNV-1a over the values, not the bytes, so padding never counts
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    auto mix = [&hash](int value) {
+        hash = (hash ^ static_cast<uint32_t>(value)) * 0x100000001B3ULL;
+    };
+    for (const ItemRule& item : catalog.items) {
+        mix(item.cost);
+        mix(item.currency);
+    }
+    for (const HurdleRule& hurdle : catalog.hurdles) {
+        mix(hurdle.cost);
+        mix(hurdle.currency);
+        mix(hurdle.counter);
+        mix(hurdle.skipTurns);
+        mix(hurdle.pushback);
+    }
+    return hash;
+}
+
+bool loadCatalog(const char* path, Catalog& catalog, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = std::string(path) + ": cannot open rules file";
+        return false;
+    }
+
+    Catalog loaded = builtInCatalog;
+    bool itemSeen[itemTypeCount] = {};
+    bool hurdleSeen[hurdleTypeCount] = {};
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::string where = std::string(path) + ":" + std::to_string(lineNumber) + ": ";
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+
+        std::string kind, name, currencyName;
+        if (!(fields >> kind)) continue;    // blank or comment only
+
+        int cost = 0;
+        if (!(fields >> name >> cost >> currencyName)) {
+            error = where + "expected '" + kind + " <name> <cost> <currency> ...'";
+            return false;
+        }
+        int currency = findName(currencyNames, 3, currencyName);
+        if (currency < 0) {
+            error = where + "unknown currency '" + currencyName + "' (any, gold or silver)";
+            return false;
+        }
+        if (!validCost(cost, static_cast<Currency>(currency))) {
+            if (cost <= 0 || cost > maxCost)
+                error = where + "cost must be between 1 and " + std::to_string(maxCost);
+            else
+                error = where + "cost " + std::to_string(cost) + " cannot be paid in " + currencyName + " coins";
+            return false;
+        }
+
+        if (kind == "item") {
+            int item = findName(itemNames, itemTypeCount, name);
+            if (item < 0) {
+                error = where + "unknown item '" + name + "'";
+                return false;
+            }
+            if (itemSeen[item]) {
+                error = where + "item '" + name + "' is listed twice";
+                return false;
+            }
+            itemSeen[item] = true;
+            loaded.items[item] = { cost, static_cast<Currency>(currency) };
+        }
+        else if (kind == "hurdle") {
+            int hurdle = findName(hurdleNames, hurdleTypeCount, name);
+            if (hurdle < 0) {
+                error = where + "unknown hurdle '" + name + "'";
+                return false;
+            }
+            if (hurdleSeen[hurdle]) {
+                error = where + "hurdle '" + name + "' is listed twice";
+                return false;
+            }
+
+            std::string counterName;
+            int skipTurns = 0, pushback = 0;
+            if (!(fields >> counterName >> skipTurns >> pushback)) {
+                error = where + "expected 'hurdle <name> <cost> <currency> <counter item> <skip turns> <pushback>'";
+                return false;
+            }
+            int counter = findName(itemNames, itemTypeCount, counterName);
+            if (counter < 0) {
+                error = where + "unknown counter item '" + counterName + "'";
+                return false;
+            }
+            if (skipTurns < 0 || skipTurns > maxSkipTurns) {
+                error = where + "skip turns must be between 0 and " + std::to_string(maxSkipTurns);
+                return false;
+            }
+            if (pushback < 0 || pushback >= pathLen) {
+                error = where + "pushback must be between 0 and " + std::to_string(pathLen - 1);
+                return false;
+            }
+            hurdleSeen[hurdle] = true;
+            loaded.hurdles[hurdle] = { cost, static_cast<Currency>(currency), static_cast<ItemType>(counter), skipTurns, pushback };
+        }
+        else {
+            error = where + "unknown entry '" + kind + "' (item or hurdle)";
+            return false;
+        }
+
+        std::string extra;
+        if (fields >> extra) {
+            error = where + "unexpected '" + extra + "'";
+            return false;
+        }
+    }
+
+    for (int i = 0; i < itemTypeCount; i++) {
+        if (!itemSeen[i]) {
+            error = std::string(path) + ": item '" + itemNames[i] + "' is missing";
+            return false;
+        }
+    }
+    for (int h = 0; h < hurdleTypeCount; h++) {
+        if (!hurdleSeen[h]) {
+            error = std::string(path) + ": hurdle '" + hurdleNames[h] + "' is missing";
+            return false;
+        }
+    }
+
+    catalog = loaded;
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "GameEngine.h"
+
+#include <string>
+
+// Prices and effects of everything in the shop, indexed by ItemType and
+// HurdleType. The built-in values are the assignment's; a rules file can
+// replace them without recompiling (see rules.txt).
+
+struct ItemRule {
+    int cost;
+    Currency currency;
+};
+
+struct HurdleRule {
+    int cost;
+    Currency currency;
+    ItemType counter;   // inventory slot used up to get past it
+    int skipTurns;      // turns lost without the counter item
+    int pushback;       // steps sent back along the path without it
+};
+
+// Longest penalty a rules file may set; the turn wheel (Turns.h) and
+// restored snapshots rely on it
+const int maxSkipTurns = 99;
+
+struct Catalog {
+    ItemRule items[itemTypeCount];
+    HurdleRule hurdles[hurdleTypeCount];
+};
+
+const Catalog& defaultCatalog();
+
+// Reads a rules file over a copy of the defaults. Every item and hurdle
+// must be listed exactly once; on any problem returns false and describes
+// it in `error` as "path:line: reason".
+bool loadCatalog(const char* path, Catalog& catalog, std::string& error);
+
+// The rules step() plays by. Only change them while no games are running.
+extern Catalog activeRules;
+
+inline const Catalog& rules() {
+    return activeRules;
+}
+
+void setRules(const Catalog& catalog);
+
+// Fingerprint of every price and effect, so recordings made under other
+// rules can be told apart
+uint64_t catalogHash(const Catalog& catalog);
+
+extern const char* const currencyNames[3];
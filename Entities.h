@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Pool.h"
+
+#include <cstdint>
+
+// Board entities stored as components: one dense array per field, indexed
+// by slot, with the slot pool holding each slot's lifecycle. Systems in
+// step() walk the arrays directly, so there is no per-entity object or
+// vtable. A new kind of entity (a power-up, a moving hazard) is another
+// table plus a system, not a subclass.
+template <int Capacity>
+struct EntityTable {
+    SlotPool<Capacity> slots;   // lifecycle: live, or free for reuse
+    int16_t cell[Capacity];     // position, as a cellIndex()
+    uint8_t type[Capacity];     // kind-specific: CoinType, HurdleType, ...
+
+    EntityTable() {
+        for (int i = 0; i < Capacity; i++) {
+            cell[i] = 0;
+            type[i] = 0;
+        }
+    }
+
+    // Slot of the new entity, or -1 if the table is full
+    int add(int entityCell, int entityType) {
+        int slot = slots.acquire();
+        if (slot >= 0) {
+            cell[slot] = static_cast<int16_t>(entityCell);
+            type[slot] = static_cast<uint8_t>(entityType);
+        }
+        return slot;
+    }
+
+    // The components stay readable until the slot is reused
+    void remove(int slot) {
+        slots.release(slot);
+    }
+
+    bool full() const { return slots.full(); }
+    bool isLive(int slot) const { return slots.isLive(slot); }
+    int end() const { return slots.end(); }
+};
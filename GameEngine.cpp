@@ -0,0 +1,376 @@
+#include "GameEngine.h"
+#include "Catalog.h"
+#include "Payment.h"
+
+const char* const itemNames[itemTypeCount] = { "sword", "shield", "water", "key" };
+const char* const hurdleNames[hurdleTypeCount] = { "fire", "snake", "ghost", "lion", "lock" };
+
+bool isStartOrGoal(int x, int y) {
+    return Board::isStartOrGoal(cellIndex(x, y));
+}
+
+PlayerState::PlayerState(int playerIndex) : pos(0), goldCoins(INITIAL_GOLD), silverCoins(INITIAL_SILVER),
+    score(0), skipTurns(0), atGoal(false), index(playerIndex) {
+    for (int i = 0; i < itemTypeCount; i++) {
+        items[i] = 1;
+    }
+}
+
+bool PlayerState::move() {
+    if (skipTurns > 0) {
+        skipTurns--;
+        return false;
+    }
+
+    if (pos + 1 < pathLen) {
+        pos++;
+
+        // Check if player has reached the goal
+        if (Board::pathCell(index, pos) == Board::goalCell) {
+            atGoal = true;
+        }
+    }
+    return true;
+}
+
+void PlayerState::collectCoin(CoinType type, StepResult& result) {
+    if (type == GOLD) {
+        goldCoins++;
+        score += GOLD_COIN_POINTS;
+    }
+    else {
+        silverCoins++;
+        score += SILVER_COIN_POINTS;
+    }
+    result.addEvent(EVENT_COIN_COLLECTED, index, type);
+}
+
+bool PlayerState::canAfford(int price) const {
+    return payments().lookup(price, goldCoins, silverCoins).affordable();
+}
+
+bool PlayerState::pay(int price) {
+    Payment payment = payments().lookup(price, goldCoins, silverCoins);
+    if (!payment.affordable())
+        return false;  // Not enough coins
+
+    goldCoins -= payment.gold;
+    silverCoins -= payment.silver;
+    score -= payment.value();
+    return true;
+}
+
+bool PlayerState::buyItem(ItemType item) {
+    if (!pay(itemPrice(item))) return false;
+    items[item]++;
+    return true;
+}
+
+bool PlayerState::buyHurdle(HurdleType hurdle) {
+    return pay(hurdlePrice(hurdle));
+}
+
+void PlayerState::handleHurdle(HurdleType type, StepResult& result) {
+    const HurdleRule& rule = rules().hurdles[type];
+    bool blocked = false;
+    if (items[rule.counter] > 0) {
+        items[rule.counter]--;
+        blocked = true;
+    }
+    else {
+        skipTurns = rule.skipTurns;
+        if (rule.pushback > 0 && pos >= rule.pushback) pos -= rule.pushback;
+    }
+    result.addEvent(blocked ? EVENT_HURDLE_BLOCKED : EVENT_HURDLE_HIT, index, type);
+}
+
+GameState::GameState() : currentPlayer(0), gameOver(false), pendingPlayers(0), seed(0) {
+    for (int p = 0; p < playerCount; p++) {
+        players[p] = PlayerState(p);
+    }
+    for (int i = 0; i < gridSize * gridSize; i++) {
+        cellCoin[i] = -1;
+        cellHurdle[i] = -1;
+    }
+}
+
+void rebuildOccupancy(GameState& state) {
+    for (int i = 0; i < gridSize * gridSize; i++) {
+        state.cellCoin[i] = -1;
+        state.cellHurdle[i] = -1;
+    }
+    for (int c = 0; c < state.coins.end(); c++) {
+        if (state.coins.isLive(c)) {
+            state.cellCoin[state.coins.cell[c]] = static_cast<int16_t>(c);
+        }
+    }
+    for (int h = 0; h < state.hurdles.end(); h++) {
+        if (state.hurdles.isLive(h)) {
+            state.cellHurdle[state.hurdles.cell[h]] = static_cast<int16_t>(h);
+        }
+    }
+    state.pendingPlayers = allPlayers;
+}
+
+void newGame(GameState& state, uint64_t seed) {
+    state = GameState();
+    state.seed = seed;
+    state.rng.seed(seed);
+    Rng& rng = state.rng;
+
+    // One distinct cell per coin and hurdle, never a start or the goal
+    int cells[coinCount + hurdleCount];
+    drawOpenCells(rng, coinCount + hurdleCount, cells);
+
+    for (int i = 0; i < coinCount; i++) {
+        int slot = state.coins.add(cells[i], i < 4 ? GOLD : SILVER);
+        state.cellCoin[cells[i]] = static_cast<int16_t>(slot);
+    }
+
+    for (int i = 0; i < hurdleCount; i++) {
+        int cell = cells[coinCount + i];
+        int slot = state.hurdles.add(cell, rng.below(hurdleTypeCount));
+        state.cellHurdle[cell] = static_cast<int16_t>(slot);
+    }
+}
+
+bool drawOpenCells(Rng& rng, int count, int* cells) {
+    if (count < 0 || count > Board::openCellCount) {
+        return false;
+    }
+
+    // Partial Fisher-Yates: only the first `count` places get shuffled
+    int open[Board::openCellCount];
+    for (int i = 0; i < Board::openCellCount; i++) {
+        open[i] = Board::openCell(i);
+    }
+    for (int i = 0; i < count; i++) {
+        int j = i + rng.below(Board::openCellCount - i);
+        int picked = open[j];
+        open[j] = open[i];
+        cells[i] = picked;
+    }
+    return true;
+}
+
+// Lowest slot at or above `from` that the occupancy table holds under one
+// of the `players` (a bit per player), or `none`. Only their own cells are
+// looked at.
+static int nextUnderPlayers(const GameState& state, uint32_t players, const int16_t* occupancy, int from, int none) {
+    int found = none;
+    for (int p = 0; players >> p; p++) {
+        if (!(players >> p & 1)) continue;
+        int index = occupancy[state.players[p].cell()];
+        if (index >= from && index < found) {
+            found = index;
+        }
+    }
+    return found;
+}
+
+// Lowest-numbered of the `players` standing on `cell`, or -1
+static int playerOn(const GameState& state, uint32_t players, int cell) {
+    for (int p = 0; players >> p; p++) {
+        if ((players >> p & 1) && state.players[p].cell() == cell) return p;
+    }
+    return -1;
+}
+
+// Coin system: the first player on a live coin's cell takes it.
+static void collectCoins(GameState& state, uint32_t players, StepResult& result) {
+    for (int i = nextUnderPlayers(state, players, state.cellCoin, 0, entityCapacity); i < entityCapacity;
+        i = nextUnderPlayers(state, players, state.cellCoin, i + 1, entityCapacity)) {
+        int cell = state.coins.cell[i];
+        state.players[playerOn(state, players, cell)].collectCoin(static_cast<CoinType>(state.coins.type[i]), result);
+        state.cellCoin[cell] = -1;
+        state.coins.remove(i);
+    }
+}
+
+// Hurdle system. Hurdles are visited in slot order, as the old scan over
+// every hurdle did, so a player pushed back by a snake still meets a
+// later-numbered hurdle on the same turn and an earlier-numbered one on
+// the next.
+static void resolveHurdles(GameState& state, uint32_t players, StepResult& result) {
+    for (int i = nextUnderPlayers(state, players, state.cellHurdle, 0, entityCapacity); i < entityCapacity;
+        i = nextUnderPlayers(state, players, state.cellHurdle, i + 1, entityCapacity)) {
+        int cell = state.hurdles.cell[i];
+        state.players[playerOn(state, players, cell)].handleHurdle(static_cast<HurdleType>(state.hurdles.type[i]), result);
+        state.cellHurdle[cell] = -1;
+        state.hurdles.remove(i);
+    }
+}
+
+// Nobody else can be on a live coin or hurdle, so only the mover and the
+// pending players need looking at
+static void checkCollisions(GameState& state, int mover, StepResult& result) {
+    uint32_t players = state.pendingPlayers | uint32_t(1) << mover;
+    collectCoins(state, players, result);
+    resolveHurdles(state, players, result);
+
+    // Whoever is still on something met it after its turn came round
+    // (a pushback onto a lower slot) and is looked at again next move
+    state.pendingPlayers = 0;
+    for (int p = 0; players >> p; p++) {
+        if (!(players >> p & 1)) continue;
+        int cell = state.players[p].cell();
+        if (state.cellCoin[cell] >= 0 || state.cellHurdle[cell] >= 0) {
+            state.pendingPlayers |= uint32_t(1) << p;
+        }
+
+        // Check if any player reached the goal
+        if (state.players[p].atGoal) {
+            state.gameOver = true;
+        }
+    }
+}
+
+// Marks the players standing on `cell` for the next collision check
+static void markPlayersOn(GameState& state, int cell) {
+    for (int p = 0; p < playerCount; p++) {
+        if (state.players[p].cell() == cell) {
+            state.pendingPlayers |= uint32_t(1) << p;
+        }
+    }
+}
+
+// Whether a new coin or hurdle may go on (gridX, gridY)
+static StepError checkEmptyCell(const GameState& state, int gridX, int gridY) {
+    // Make sure grid position is valid
+    if (gridX < 0 || gridX >= gridSize || gridY < 0 || gridY >= gridSize) {
+        return STEP_INVALID_CELL;
+    }
+
+    // Don't place on player start or goal positions
+    if (isStartOrGoal(gridX, gridY)) {
+        return STEP_START_OR_GOAL;
+    }
+
+    // Check if position already has a coin or hurdle
+    int cell = cellIndex(gridX, gridY);
+    if (state.cellCoin[cell] >= 0) {
+        return STEP_CELL_HAS_COIN;
+    }
+    if (state.cellHurdle[cell] >= 0) {
+        return STEP_CELL_HAS_HURDLE;
+    }
+    return STEP_OK;
+}
+
+static StepError placeHurdle(GameState& state, const Action& action, StepResult& result) {
+    StepError error = checkEmptyCell(state, action.x, action.y);
+    if (error != STEP_OK) {
+        return error;
+    }
+    // Checked before paying, so a purchase is never taken without a hurdle
+    if (state.hurdles.full()) {
+        return STEP_BOARD_FULL;
+    }
+
+    HurdleType type = static_cast<HurdleType>(action.item);
+    if (!state.players[action.player].buyHurdle(type)) {
+        return STEP_NOT_ENOUGH_COINS;
+    }
+
+    int cell = cellIndex(action.x, action.y);
+    state.cellHurdle[cell] = static_cast<int16_t>(state.hurdles.add(cell, type));
+    markPlayersOn(state, cell);
+
+    result.addEvent(EVENT_HURDLE_PLACED, action.player, type);
+    return STEP_OK;
+}
+
+StepError spawnCoin(GameState& state, int x, int y, CoinType type) {
+    StepError error = checkEmptyCell(state, x, y);
+    if (error != STEP_OK) {
+        return error;
+    }
+    if (state.coins.full()) {
+        return STEP_BOARD_FULL;
+    }
+
+    int cell = cellIndex(x, y);
+    state.cellCoin[cell] = static_cast<int16_t>(state.coins.add(cell, type));
+    markPlayersOn(state, cell);
+    return STEP_OK;
+}
+
+StepResult step(GameState& state, const Action& action) {
+    StepResult result;
+
+    if (state.gameOver) {
+        result.error = STEP_GAME_OVER;
+        return result;
+    }
+    if (action.player < 0 || action.player >= playerCount) {
+        result.error = STEP_BAD_ACTION;
+        return result;
+    }
+
+    PlayerState& player = state.players[action.player];
+
+    switch (action.type) {
+    case ACTION_MOVE:
+    {
+        state.currentPlayer = action.player;
+        int before = player.pos;
+        if (!player.move()) {
+            result.addEvent(EVENT_TURN_SKIPPED, action.player);
+        }
+        else if (player.pos != before) {
+            result.addEvent(EVENT_MOVED, action.player);
+        }
+        checkCollisions(state, action.player, result);
+        if (player.atGoal) {
+            result.addEvent(EVENT_REACHED_GOAL, action.player);
+        }
+        break;
+    }
+
+    case ACTION_BUY_ITEM:
+        if (action.item < 0 || action.item >= itemTypeCount) {
+            result.error = STEP_BAD_ACTION;
+        }
+        else if (player.buyItem(static_cast<ItemType>(action.item))) {
+            result.addEvent(EVENT_ITEM_BOUGHT, action.player, action.item);
+        }
+        else {
+            result.error = STEP_NOT_ENOUGH_COINS;
+        }
+        break;
+
+    case ACTION_PLACE_HURDLE:
+        if (action.item < 0 || action.item >= hurdleTypeCount) {
+            result.error = STEP_BAD_ACTION;
+        }
+        else {
+            result.error = placeHurdle(state, action, result);
+        }
+        break;
+
+    default:
+        result.error = STEP_BAD_ACTION;
+        break;
+    }
+
+    return result;
+}
+
+int winner(const GameState& state) {
+    int best = -1;
+    bool tied = false;
+    for (int p = 0; p < playerCount; p++) {
+        const PlayerState& player = state.players[p];
+        if (!player.atGoal) continue;
+
+        // Several reached the goal, compare scores
+        if (best < 0 || player.getScore() > state.players[best].getScore()) {
+            best = p;
+            tied = false;
+        }
+        else if (player.getScore() == state.players[best].getScore()) {
+            tied = true;
+        }
+    }
+    return tied ? -1 : best;
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include "Board.h"
+#include "Entities.h"
+#include "Rng.h"
+
+#include <cstdint>
+
+// Headless rules engine for Adventure Quest.
+// Nothing in here depends on SFML, so the rules can be driven from tools
+// and batch jobs as well as from the windowed game.
+
+// Game constants based on assignment; the board size and number of
+// players come from Board.h
+const int gridSize = Board::size;
+const int pathLen = Board::pathLength;
+const int coinCount = 8;
+const int hurdleCount = 5;
+const int playerCount = Board::playerCount;
+
+// One bit per player, as in GameState::pendingPlayers
+const uint32_t allPlayers = (uint32_t(1) << playerCount) - 1;
+
+static_assert(coinCount + hurdleCount <= Board::openCellCount, "coins and hurdles must fit beside the starts and goal");
+
+// Most coins, and most hurdles, a board can hold at once: one per open
+// cell, capped so the largest boards keep a bounded GameState
+const int entityCapacity = Board::openCellCount < 4096 ? Board::openCellCount : 4096;
+
+static_assert(Board::cellCount <= 32767, "cell indices must fit EntityTable::cell");
+
+// Point values from assignment
+const int GOLD_COIN_POINTS = 10;
+const int SILVER_COIN_POINTS = 5;
+
+// Built-in item costs; the rules actually played come from Catalog.h
+const int SWORD_COST = 40;
+const int SHIELD_COST = 30;
+const int WATER_COST = 50;
+const int KEY_COST = 70;
+
+// Hurdle costs
+const int FIRE_COST = 50;
+const int SNAKE_COST = 30;
+const int GHOST_COST = 20;
+const int LION_COST = 50;    // Only with gold coins
+const int LOCK_COST = 60;    // Only with silver coins
+
+// Initial money
+const int INITIAL_GOLD = 20;
+const int INITIAL_SILVER = 40;
+
+enum CoinType { GOLD, SILVER };
+enum HurdleType { FIRE, SNAKE, GHOST, LION, LOCK };
+enum ItemType { SWORD, SHIELD, WATER, KEY };
+
+// Which coins a price may be paid in
+enum Currency {
+    PAY_ANY,        // any mix, overpaying as little as possible
+    PAY_GOLD,       // whole gold coins only
+    PAY_SILVER      // whole silver coins only
+};
+
+const int hurdleTypeCount = 5;
+const int itemTypeCount = 4;
+
+// Lower-case names used by the shop ("sword", "fire", ...)
+extern const char* const itemNames[itemTypeCount];
+extern const char* const hurdleNames[hurdleTypeCount];
+
+struct Cell {
+    int x, y;
+};
+
+// Row-major index of a cell, as used by the occupancy tables
+inline int cellIndex(int x, int y) {
+    return y * gridSize + x;
+}
+
+// Things that happened during a step; the client turns these into
+// console output and status messages.
+enum EventType {
+    EVENT_MOVED,
+    EVENT_TURN_SKIPPED,
+    EVENT_COIN_COLLECTED,   // detail: CoinType
+    EVENT_HURDLE_BLOCKED,   // detail: HurdleType, an item was used up
+    EVENT_HURDLE_HIT,       // detail: HurdleType
+    EVENT_REACHED_GOAL,
+    EVENT_ITEM_BOUGHT,      // detail: ItemType
+    EVENT_HURDLE_PLACED     // detail: HurdleType
+};
+
+struct GameEvent {
+    EventType type;
+    int player;
+    int detail;
+};
+
+// Why an action was refused
+enum StepError {
+    STEP_OK,
+    STEP_GAME_OVER,
+    STEP_BAD_ACTION,
+    STEP_INVALID_CELL,
+    STEP_START_OR_GOAL,
+    STEP_CELL_HAS_COIN,
+    STEP_CELL_HAS_HURDLE,
+    STEP_NOT_ENOUGH_COINS,
+    STEP_BOARD_FULL         // every coin or hurdle slot is in use
+};
+
+const int maxStepEvents = 16;
+
+struct StepResult {
+    StepError error;
+    int eventCount;
+    GameEvent events[maxStepEvents];
+
+    StepResult() : error(STEP_OK), eventCount(0) {}
+
+    bool ok() const { return error == STEP_OK; }
+
+    void addEvent(EventType type, int player, int detail = 0) {
+        if (eventCount < maxStepEvents) {
+            events[eventCount++] = { type, player, detail };
+        }
+    }
+};
+
+class PlayerState {
+public:
+    int pos;        // step along Board's path for this player
+    int goldCoins, silverCoins;
+    int score;
+    int skipTurns;
+    int items[itemTypeCount];   // how many of each ItemType the player holds
+    bool atGoal;
+    int index;
+
+    PlayerState() : PlayerState(0) {}
+    explicit PlayerState(int playerIndex);
+
+    // Returns false if the player had to sit the turn out
+    bool move();
+
+    Cell getPosition() const {
+        int cell = Board::pathCell(index, pos);
+        return { cell % gridSize, cell / gridSize };
+    }
+
+    // Cell index of the player's current step
+    int cell() const {
+        return Board::pathCell(index, pos);
+    }
+
+    void collectCoin(CoinType type, StepResult& result);
+    bool canAfford(int price) const;
+    bool pay(int price);    // price slot, see Payment.h
+    bool buyItem(ItemType item);
+    bool buyHurdle(HurdleType hurdle);
+    void handleHurdle(HurdleType type, StepResult& result);
+
+    int getScore() const {
+        return score;
+    }
+};
+
+enum ActionType { ACTION_MOVE, ACTION_BUY_ITEM, ACTION_PLACE_HURDLE };
+
+struct Action {
+    ActionType type;
+    int player;
+    int item;   // ItemType for purchases, HurdleType for placements
+    int x, y;
+
+    static Action move(int player) {
+        return { ACTION_MOVE, player, 0, 0, 0 };
+    }
+    static Action buyItem(int player, ItemType item) {
+        return { ACTION_BUY_ITEM, player, item, 0, 0 };
+    }
+    static Action placeHurdle(int player, HurdleType type, int x, int y) {
+        return { ACTION_PLACE_HURDLE, player, type, x, y };
+    }
+};
+
+struct GameState {
+    PlayerState players[playerCount];
+    EntityTable<entityCapacity> coins;      // type is a CoinType; collected coins free their slot
+    EntityTable<entityCapacity> hurdles;    // type is a HurdleType; so do triggered hurdles
+    int currentPlayer;  // player who moved last, and who pays in the shop
+    bool gameOver;
+
+    // Players other than the mover who may be standing on a live coin or
+    // hurdle, one bit each: pushed back onto one, or had one put under
+    // them. A move only checks the mover and these, whatever playerCount.
+    uint32_t pendingPlayers;
+    uint64_t seed;      // newGame(state, seed) rebuilds this board exactly
+    Rng rng;
+
+    // Slot of the live coin / hurdle on each cell (see cellIndex), or -1.
+    // step() keeps these in sync; code that edits coins or hurdles
+    // directly must call rebuildOccupancy() afterwards.
+    int16_t cellCoin[gridSize * gridSize];
+    int16_t cellHurdle[gridSize * gridSize];
+
+    GameState();
+};
+
+// Randomly lays out coins and hurdles and resets every player. The same
+// seed always gives the same board.
+void newGame(GameState& state, uint64_t seed);
+
+// Writes `count` distinct random cells that are neither a start nor the
+// goal into `cells`, in O(cells) time. Returns false, leaving `cells`
+// untouched, if the board does not have that many such cells.
+bool drawOpenCells(Rng& rng, int count, int* cells);
+
+// Puts a new coin on an empty open cell mid-game. Refuses the same cells
+// placing a hurdle does.
+StepError spawnCoin(GameState& state, int x, int y, CoinType type);
+
+// Recomputes cellCoin and cellHurdle from the live coins and hurdles, and
+// has the next move check every player
+void rebuildOccupancy(GameState& state);
+
+// Applies one action to the state. Refused actions leave the state untouched.
+StepResult step(GameState& state, const Action& action);
+
+// Index of the winning player, or -1 for a tie or a game still in progress.
+// Of the players on the goal the highest score wins.
+int winner(const GameState& state);
+
+bool isStartOrGoal(int x, int y);
+
+// Cell at step `pos` of `player`'s path
+inline Cell pathCell(int player, int pos) {
+    int cell = Board::pathCell(player, pos);
+    return { cell % gridSize, cell / gridSize };
+}
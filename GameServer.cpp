@@ -0,0 +1,212 @@
+#include "GameServer.h"
+#include "Rng.h"
+
+#if !defined(__linux__)
+#error "GameServer is built on epoll and needs Linux"
+#endif
+
+#include <algorithm>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+// epoll data for a shard's listening socket; rooms use their index
+const uint64_t listenerTag = ~0ULL;
+const int eventsPerWait = 256;
+const int stopCheckMillis = 50;
+
+// Board of a room's `match`th match
+static uint64_t boardSeed(uint64_t seed, uint64_t room, uint64_t match) {
+    return Rng(seed, room << 32 | match).next();
+}
+
+struct GameServer::Room {
+    NetSession session;
+    GameState state;
+    uint64_t stream;    // room number across every shard, for boardSeed()
+    uint64_t matches;
+    bool writing;       // watched for EPOLLOUT while its session has output queued
+};
+
+struct GameServer::Shard {
+    Socket listener;
+    int epoll;
+    std::vector<Room> rooms;
+    std::vector<int> freeRooms;     // a stack, so recently used rooms are reused first
+    std::thread worker;
+
+    std::atomic<long long> sessions, refused, actions, matches, openRooms;
+
+    Shard(int roomCount) : epoll(-1), rooms(roomCount), sessions(0), refused(0), actions(0), matches(0), openRooms(0) {
+        freeRooms.reserve(roomCount);
+        for (int i = roomCount - 1; i >= 0; i--) {
+            freeRooms.push_back(i);
+        }
+    }
+
+    ~Shard() {
+        if (epoll >= 0) ::close(epoll);
+    }
+};
+
+GameServer::GameServer(const ServerConfig& settings) : config(settings), stopping(false), boundPort(0) {}
+
+GameServer::~GameServer() {
+    stop();
+}
+
+bool GameServer::start(std::string& error) {
+    stop();
+    stopping = false;
+    Socket::raiseOpenLimit();
+
+    int threadCount = config.threads > 0 ? config.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, std::max(1, config.rooms)));
+    int perShard = (std::max(1, config.rooms) + threadCount - 1) / threadCount;
+
+    // The first shard settles the port when asked for any free one
+    boundPort = config.port;
+    for (int t = 0; t < threadCount; t++) {
+        std::unique_ptr<Shard> shard(new Shard(perShard));
+        if (!shard->listener.listen(boundPort, error, true)) {
+            shards.clear();
+            return false;
+        }
+        boundPort = shard->listener.port();
+        shard->listener.setNonBlocking();
+
+        shard->epoll = epoll_create1(0);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = listenerTag;
+        if (shard->epoll < 0 || epoll_ctl(shard->epoll, EPOLL_CTL_ADD, static_cast<int>(shard->listener.handle()), &event) != 0) {
+            error = "cannot create an epoll set";
+            shards.clear();
+            return false;
+        }
+        shards.push_back(std::move(shard));
+    }
+
+    for (size_t t = 0; t < shards.size(); t++) {
+        Shard& shard = *shards[t];
+        for (size_t r = 0; r < shard.rooms.size(); r++) {
+            shard.rooms[r].stream = t * shard.rooms.size() + r;
+            shard.rooms[r].matches = 0;
+        }
+        shard.worker = std::thread([this, &shard]() { serveShard(shard); });
+    }
+    return true;
+}
+
+void GameServer::stop() {
+    stopping = true;
+    for (std::unique_ptr<Shard>& shard : shards) {
+        if (shard->worker.joinable()) shard->worker.join();
+    }
+    shards.clear();
+}
+
+ServerStats GameServer::stats() const {
+    ServerStats total = {};
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        total.sessions += shard->sessions;
+        total.refused += shard->refused;
+        total.actions += shard->actions;
+        total.matches += shard->matches;
+        total.openRooms += shard->openRooms;
+    }
+    return total;
+}
+
+void GameServer::serveShard(Shard& shard) {
+    epoll_event events[eventsPerWait];
+    while (!stopping) {
+        int ready = epoll_wait(shard.epoll, events, eventsPerWait, stopCheckMillis);
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.u64 == listenerTag) acceptRooms(shard);
+            else serveRoom(shard, static_cast<int>(events[i].data.u64), events[i].events);
+        }
+    }
+
+    for (size_t r = 0; r < shard.rooms.size(); r++) {
+        if (shard.rooms[r].session.connected()) closeRoom(shard, static_cast<int>(r));
+    }
+}
+
+void GameServer::acceptRooms(Shard& shard) {
+    Socket peer;
+    while (shard.listener.accept(peer)) {
+        if (shard.freeRooms.empty()) {
+            shard.refused++;
+            peer.close();
+            continue;
+        }
+        int index = shard.freeRooms.back();
+        shard.freeRooms.pop_back();
+        Room& room = shard.rooms[index];
+        newGame(room.state, boardSeed(config.seed, room.stream, room.matches));
+        room.session.start(std::move(peer), netEverySeat, room.state);
+        room.writing = false;
+        shard.sessions++;
+        shard.openRooms++;
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = static_cast<uint64_t>(index);
+        if (!room.session.connected() ||
+            epoll_ctl(shard.epoll, EPOLL_CTL_ADD, static_cast<int>(room.session.connection().handle()), &event) != 0 ||
+            !watchRoom(shard, index)) {
+            closeRoom(shard, index);
+        }
+    }
+}
+
+// Never waits on a player: what their socket will not take stays queued
+// in the session, and the room is woken when there is room for it
+void GameServer::serveRoom(Shard& shard, int index, uint32_t ready) {
+    Room& room = shard.rooms[index];
+    if ((ready & EPOLLOUT) && !room.session.flush()) {
+        closeRoom(shard, index);
+        return;
+    }
+    Action action;
+    while ((ready & (EPOLLIN | EPOLLHUP | EPOLLERR)) && room.session.poll(room.state, action)) {
+        shard.actions++;
+        StepResult result = step(room.state, action);
+        if (!result.ok()) {
+            room.session.reject(result.error);
+            continue;
+        }
+        room.session.publish(room.state, true);
+
+        // The finished board goes out first so the player sees the result
+        if (room.state.gameOver) {
+            shard.matches++;
+            room.matches++;
+            newGame(room.state, boardSeed(config.seed, room.stream, room.matches));
+            room.session.publish(room.state);
+        }
+    }
+    if (!room.session.connected() || !watchRoom(shard, index)) {
+        closeRoom(shard, index);
+    }
+}
+
+// Asks for EPOLLOUT only while output is queued, since an idle socket is
+// nearly always writable
+bool GameServer::watchRoom(Shard& shard, int index) {
+    Room& room = shard.rooms[index];
+    bool writing = room.session.sending();
+    if (writing == room.writing) return true;
+    epoll_event event = {};
+    event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(index);
+    room.writing = writing;
+    return epoll_ctl(shard.epoll, EPOLL_CTL_MOD, static_cast<int>(room.session.connection().handle()), &event) == 0;
+}
+
+// Closing the socket also takes it out of the epoll set
+void GameServer::closeRoom(Shard& shard, int index) {
+    shard.rooms[index].session.close();
+    shard.freeRooms.push_back(index);
+    shard.openRooms--;
+}
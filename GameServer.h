@@ -0,0 +1,81 @@
+#pragma once
+
+#include "NetPlay.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless server hosting many independent match rooms in one process.
+// Every connection gets a room of its own and plays every seat of it, as
+// the window does on one keyboard; the room is authoritative and speaks
+// the network play protocol (NetProtocol.h), so --join works against it.
+// A finished match is published and the room starts the next one.
+//
+// Each worker thread owns a shard: its own listening socket on the shared
+// port, its own epoll set and a fixed pool of rooms sized at start-up.
+// The kernel spreads new connections over the shards, and a room is only
+// ever touched by its shard's thread, so nothing is locked. Nor does a
+// shard wait on any player: output a socket will not take is queued in
+// the session and sent once epoll reports room, and a player who stops
+// reading is hung up on (netMaxOutbound). Linux only.
+struct ServerConfig {
+    uint16_t port;
+    int threads;        // 0 = one per hardware thread
+    int rooms;          // room pool across all shards; connections beyond it are refused
+    uint64_t seed;      // boards are derived from this, the room and its match count
+
+    ServerConfig() : port(7777), threads(0), rooms(16384), seed(1) {}
+};
+
+struct ServerStats {
+    long long sessions;     // connections accepted
+    long long refused;      // connections turned away with every room taken
+    long long actions;      // actions received
+    long long matches;      // matches finished
+    long long openRooms;
+};
+
+class GameServer {
+public:
+    explicit GameServer(const ServerConfig& settings);
+    ~GameServer();
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    // Binds the port and starts the workers
+    bool start(std::string& error);
+
+    // Closes every room and waits for the workers to finish
+    void stop();
+
+    uint16_t port() const {
+        return boundPort;
+    }
+
+    int threads() const {
+        return static_cast<int>(shards.size());
+    }
+
+    // Counters summed over the shards; may be a moment behind
+    ServerStats stats() const;
+
+private:
+    struct Room;
+    struct Shard;
+
+    ServerConfig config;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping;
+    uint16_t boundPort;
+
+    void serveShard(Shard& shard);
+    void acceptRooms(Shard& shard);
+    void serveRoom(Shard& shard, int index, uint32_t ready);
+    bool watchRoom(Shard& shard, int index);
+    void closeRoom(Shard& shard, int index);
+};
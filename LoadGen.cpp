@@ -0,0 +1,243 @@
+#include "NetPlay.h"
+#include "Rng.h"
+
+#if !defined(__linux__)
+#error "LoadGen is built on epoll and needs Linux"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <sys/epoll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Load generator for Server: opens many sessions, each playing every seat
+// of its room one action at a time with a think time in between, and
+// reports the latency from sending an action to hearing the answer.
+
+typedef std::chrono::steady_clock Clock;
+
+struct LoadConfig {
+    const char* host;
+    uint16_t port;
+    int sessions;
+    int threads;
+    int seconds;
+    int thinkMillis;    // mean pause between an answer and the next action
+    uint64_t seed;
+
+    LoadConfig() : host("127.0.0.1"), port(7777), sessions(10000), threads(1), seconds(10), thinkMillis(100), seed(1) {}
+};
+
+struct LoadResult {
+    std::vector<double> latencyMicros;
+    long long connected;
+    long long failed;       // sessions that could not connect
+    long long dropped;      // sessions the server hung up on
+    long long rejected;
+    std::string firstError;
+
+    LoadResult() : connected(0), failed(0), dropped(0), rejected(0) {}
+};
+
+struct LoadSession {
+    NetClient client;
+    GameState state;
+    Rng rng;
+    int seat;
+    bool waiting;           // an action is out and unanswered
+    Clock::time_point sentAt;
+};
+
+// Something other than a move now and then, which the room may refuse
+static Action nextAction(LoadSession& session) {
+    int player = session.seat;
+    if (session.rng.below(8) == 0) {
+        return Action::buyItem(player, static_cast<ItemType>(session.rng.below(itemTypeCount)));
+    }
+    session.seat = (session.seat + 1) % playerCount;
+    return Action::move(player);
+}
+
+static void runSessions(const LoadConfig& config, int count, uint64_t stream, std::atomic<int>& ready, LoadResult& result) {
+    std::vector<LoadSession> sessions(count);
+    int epoll = epoll_create1(0);
+
+    // Connect one after another; each connect() waits for its keyframe
+    for (int i = 0; i < count; i++) {
+        LoadSession& session = sessions[i];
+        session.rng = Rng(config.seed, stream + i);
+        session.seat = 0;
+        session.waiting = false;
+        std::string error;
+        if (!session.client.connect(config.host, config.port, session.state, error)) {
+            if (result.firstError.empty()) result.firstError = error;
+            result.failed++;
+            continue;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epoll, EPOLL_CTL_ADD, static_cast<int>(session.client.connection().handle()), &event);
+        result.connected++;
+    }
+
+    // Start together once every thread is connected
+    ready--;
+    while (ready > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Sessions due to act, soonest first; the first actions are spread
+    // over one think time
+    typedef std::pair<Clock::time_point, int> Due;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> due;
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::seconds(config.seconds);
+    for (int i = 0; i < count; i++) {
+        if (!sessions[i].client.connected()) continue;
+        due.push(Due(start + std::chrono::microseconds(sessions[i].rng.below(config.thinkMillis * 1000 + 1)), i));
+    }
+
+    const int eventsPerWait = 256;
+    epoll_event events[eventsPerWait];
+    while (true) {
+        Clock::time_point now = Clock::now();
+        if (now >= end) break;
+        while (!due.empty() && due.top().first <= now) {
+            LoadSession& session = sessions[due.top().second];
+            due.pop();
+            if (!session.client.connected()) continue;
+            session.sentAt = Clock::now();
+            session.waiting = session.client.send(nextAction(session));
+            if (!session.waiting) result.dropped++;
+        }
+
+        int timeout = 1;
+        if (!due.empty()) {
+            auto until = std::chrono::duration_cast<std::chrono::milliseconds>(due.top().first - Clock::now()).count();
+            timeout = static_cast<int>(std::max<long long>(0, std::min<long long>(until, 50)));
+        }
+        int got = epoll_wait(epoll, events, eventsPerWait, timeout);
+        for (int e = 0; e < got; e++) {
+            int index = static_cast<int>(events[e].data.u32);
+            LoadSession& session = sessions[index];
+            NetUpdate update;
+            while ((update = session.client.poll(session.state)) != NET_IDLE) {
+                if (update == NET_DISCONNECTED) {
+                    if (result.firstError.empty()) result.firstError = session.client.error();
+                    result.dropped++;
+                    break;
+                }
+                if (update == NET_REJECTED) result.rejected++;
+
+                // A finished match is followed by the next board; only the
+                // first answer counts
+                if (!session.waiting) continue;
+                Clock::time_point answered = Clock::now();
+                std::chrono::duration<double, std::micro> latency = answered - session.sentAt;
+                result.latencyMicros.push_back(latency.count());
+                session.waiting = false;
+                int think = config.thinkMillis > 0 ? session.rng.below(2 * config.thinkMillis * 1000 + 1) : 0;
+                due.push(Due(answered + std::chrono::microseconds(think), index));
+            }
+        }
+    }
+    ::close(epoll);
+}
+
+static double percentile(std::vector<double>& samples, double fraction) {
+    if (samples.empty()) return 0.0;
+    size_t rank = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+static void printUsage() {
+    std::cout << "Usage: LoadGen [--host HOST] [--port N] [--sessions N] [--threads N] [--seconds N] [--think MS] [--seed N]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LoadConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--help") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (!value) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if (std::strcmp(arg, "--host") == 0) config.host = value;
+        else if (std::strcmp(arg, "--port") == 0) config.port = static_cast<uint16_t>(std::atoi(value));
+        else if (std::strcmp(arg, "--sessions") == 0) config.sessions = std::atoi(value);
+        else if (std::strcmp(arg, "--threads") == 0) config.threads = std::atoi(value);
+        else if (std::strcmp(arg, "--seconds") == 0) config.seconds = std::atoi(value);
+        else if (std::strcmp(arg, "--think") == 0) config.thinkMillis = std::atoi(value);
+        else if (std::strcmp(arg, "--seed") == 0) config.seed = std::strtoull(value, nullptr, 10);
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        i++;
+    }
+
+    config.threads = std::max(1, std::min(config.threads, config.sessions));
+    int limit = Socket::raiseOpenLimit();
+    if (limit > 0 && config.sessions + 16 > limit) {
+        std::cerr << "Warning: " << config.sessions << " sessions need more than the open file limit of " << limit << std::endl;
+    }
+
+    std::cout << "Opening " << config.sessions << " sessions to " << config.host << ":" << config.port << " from "
+        << config.threads << " thread(s)..." << std::endl;
+    std::vector<LoadResult> results(config.threads);
+    std::vector<std::thread> threads;
+    std::atomic<int> ready(config.threads);
+    Clock::time_point connecting = Clock::now();
+    for (int t = 0; t < config.threads; t++) {
+        int count = config.sessions / config.threads + (t < config.sessions % config.threads ? 1 : 0);
+        uint64_t stream = static_cast<uint64_t>(t) * config.sessions;
+        threads.emplace_back([&config, &ready, &results, count, stream, t]() { runSessions(config, count, stream, ready, results[t]); });
+    }
+    while (ready > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::chrono::duration<double> connectSeconds = Clock::now() - connecting;
+    for (std::thread& thread : threads) thread.join();
+
+    LoadResult total;
+    for (LoadResult& result : results) {
+        total.latencyMicros.insert(total.latencyMicros.end(), result.latencyMicros.begin(), result.latencyMicros.end());
+        total.connected += result.connected;
+        total.failed += result.failed;
+        total.dropped += result.dropped;
+        total.rejected += result.rejected;
+        if (total.firstError.empty()) total.firstError = result.firstError;
+    }
+
+    std::vector<double>& latency = total.latencyMicros;
+    std::cout << total.connected << " sessions connected in " << connectSeconds.count() << " s, " << total.failed
+        << " failed, " << total.dropped << " dropped" << std::endl;
+    if (!total.firstError.empty()) std::cout << "First error: " << total.firstError << std::endl;
+    std::cout << latency.size() << " actions answered (" << total.rejected << " refused), "
+        << static_cast<long long>(latency.size() / std::max(1, config.seconds)) << " per second" << std::endl;
+    double p50 = percentile(latency, 0.5);
+    double p99 = percentile(latency, 0.99);
+    double p999 = percentile(latency, 0.999);
+    double worst = latency.empty() ? 0.0 : *std::max_element(latency.begin(), latency.end());
+    std::cout << "Latency: p50 " << p50 << " us, p99 " << p99 << " us, p99.9 " << p999 << " us, max " << worst << " us" << std::endl;
+    return total.failed > 0 || total.dropped > 0 ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. The bytes are used
+// where they lie; nothing is copied or parsed on open, and pages are only
+// read from disk when they are first touched.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps `path`, replacing any file mapped before. On failure returns
+    // false, describes the problem in `error` and leaves nothing mapped.
+    bool open(const char* path, std::string& error);
+    void close();
+
+    const unsigned char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+private:
+    const unsigned char* bytes;
+    size_t length;
+};
@@ -0,0 +1,301 @@
+#include "NetPlay.h"
+#include "Catalog.h"
+
+#include <cstring>
+
+const int helloSize = 11;
+
+int writeHello(uint8_t* message, int seat) {
+    uint8_t* body = message + netHeaderSize;
+    body[0] = static_cast<uint8_t>(seat);
+    body[1] = static_cast<uint8_t>(gridSize);
+    body[2] = static_cast<uint8_t>(playerCount);
+    uint64_t hash = catalogHash(rules());
+    putU32(body + 3, static_cast<uint32_t>(hash));
+    putU32(body + 7, static_cast<uint32_t>(hash >> 32));
+    return writeHeader(message, NET_HELLO, 0, helloSize);
+}
+
+NetSession::NetSession() : remoteSeat(0), stateSequence(0), actionSequence(0), sentBytes(0), outboundStart(0) {
+    std::memset(static_cast<void*>(&shared), 0, sizeof(shared));
+}
+
+void NetSession::start(Socket&& connection, int seat, const GameState& state) {
+    peer = std::move(connection);
+    peer.setNonBlocking();
+    reader.clear();
+    remoteSeat = seat;
+    actionSequence = 0;
+
+    send(writeHello(message, seat));
+    sendKeyframe(state);
+}
+
+void NetSession::close() {
+    peer.close();
+    reader.clear();
+    outbound.clear();
+    outboundStart = 0;
+}
+
+bool NetSession::poll(const GameState& state, Action& action) {
+    while (peer.isOpen()) {
+        int size = 0;
+        const uint8_t* in = reader.next(size);
+        if (!in) {
+            if (reader.broken() || !reader.fill(peer)) {
+                close();
+                return false;
+            }
+            in = reader.next(size);
+            if (!in) {
+                if (reader.broken()) close();
+                return false;
+            }
+        }
+
+        if (in[2] == NET_RESYNC) {
+            sendKeyframe(state);
+            continue;
+        }
+        if (in[2] != NET_ACTION || size != netHeaderSize + 4) {
+            close();
+            return false;
+        }
+        actionSequence = getU16(in + 3);
+        ReplayRecord record = { getU32(in + netHeaderSize) };
+        if (record.kind() == REPLAY_SELECT_PLAYER) continue;  // only the host's own shop cares
+        if (remoteSeat != netEverySeat && record.player() != remoteSeat) {
+            reject(STEP_BAD_ACTION);
+            continue;
+        }
+        action = record.action();
+        return true;
+    }
+    return false;
+}
+
+void NetSession::reject(StepError error) {
+    if (!peer.isOpen()) return;
+    message[netHeaderSize] = static_cast<uint8_t>(error);
+    send(writeHeader(message, NET_REJECT, actionSequence, 1));
+}
+
+void NetSession::publish(const GameState& state, bool answer) {
+    if (!peer.isOpen()) return;
+    Snapshot now;
+    packSnapshot(state, now);
+    const int deltaAt = netHeaderSize + 4;
+    int length = encodeDelta(shared, now, message + deltaAt, netMaxMessage - deltaAt);
+    if (length == 0 && !answer) return;
+    if (length < 0) {
+        sendKeyframe(state);
+        return;
+    }
+    putU32(message + netHeaderSize, snapshotChecksum(now));
+    send(writeHeader(message, NET_DELTA, ++stateSequence, 4 + length));
+    shared = now;
+}
+
+void NetSession::sendKeyframe(const GameState& state) {
+    packSnapshot(state, shared);
+    std::memcpy(message + netHeaderSize, &shared, sizeof(shared));
+    send(writeHeader(message, NET_KEYFRAME, ++stateSequence, sizeof(shared)));
+}
+
+// Writes straight to the socket while nothing is queued, so the queue is
+// only touched once a player falls behind
+void NetSession::send(int size) {
+    int sent = 0;
+    if (!sending()) {
+        sent = peer.send(message, size);
+        if (sent < 0) {
+            close();
+            return;
+        }
+    }
+    if (sent < size) {
+        if (outbound.size() - outboundStart + (size - sent) > static_cast<size_t>(netMaxOutbound)) {
+            close();
+            return;
+        }
+        outbound.insert(outbound.end(), message + sent, message + size);
+    }
+    sentBytes += size;
+}
+
+bool NetSession::flush() {
+    while (sending()) {
+        int sent = peer.send(outbound.data() + outboundStart, static_cast<int>(outbound.size() - outboundStart));
+        if (sent < 0) {
+            close();
+            return false;
+        }
+        if (sent == 0) break;
+        outboundStart += sent;
+    }
+    if (!sending()) {
+        outbound.clear();
+        outboundStart = 0;
+    }
+    return peer.isOpen();
+}
+
+bool NetHost::open(uint16_t port, int seat, std::string& error) {
+    if (!Socket::startup() || !listener.listen(port, error)) {
+        if (error.empty()) error = "networking is not available";
+        return false;
+    }
+    listener.setNonBlocking();
+    remoteSeat = seat;
+    return true;
+}
+
+void NetHost::close() {
+    session.close();
+    listener.close();
+}
+
+bool NetHost::poll(const GameState& state, Action& action) {
+    if (!session.connected()) {
+        Socket peer;
+        if (!listener.accept(peer)) return false;
+        session.start(std::move(peer), remoteSeat, state);
+    }
+    return session.flush() && session.poll(state, action);
+}
+
+bool NetHost::waitForInput(int milliseconds) {
+    if (!session.connected()) return listener.waitReadable(milliseconds);
+    if (session.sending()) return session.connection().waitWritable(milliseconds);
+    return session.connection().waitReadable(milliseconds);
+}
+
+NetClient::NetClient() : mySeat(-1), haveState(false), awaitingKeyframe(false), stateSequence(0), actionSequence(0),
+    rejected(STEP_OK), resyncCount(0), receivedBytes(0) {
+    std::memset(static_cast<void*>(&shared), 0, sizeof(shared));
+}
+
+bool NetClient::connect(const char* host, uint16_t port, GameState& state, std::string& error) {
+    if (!Socket::startup() || !socket.connect(host, port, error)) {
+        if (error.empty()) error = "networking is not available";
+        return false;
+    }
+    socket.setNonBlocking();
+    reader.clear();
+    haveState = false;
+    awaitingKeyframe = false;
+    failure.clear();
+
+    while (!haveState) {
+        if (!socket.waitReadable(5000)) {
+            socket.close();
+            error = std::string(host) + ": no answer from the host";
+            return false;
+        }
+        if (poll(state) == NET_DISCONNECTED) {
+            error = failure;
+            return false;
+        }
+    }
+    return true;
+}
+
+NetUpdate NetClient::poll(GameState& state) {
+    while (socket.isOpen()) {
+        int size = 0;
+        const uint8_t* in = reader.next(size);
+        if (!in) {
+            if (reader.broken()) return disconnect("the host sent a malformed message");
+            if (!reader.fill(socket)) return disconnect("the host closed the connection");
+            in = reader.next(size);
+            if (!in) {
+                return reader.broken() ? disconnect("the host sent a malformed message") : NET_IDLE;
+            }
+        }
+        receivedBytes += size;
+
+        NetUpdate update = handle(in, size, state);
+        if (update != NET_IDLE) return update;
+    }
+    return NET_DISCONNECTED;
+}
+
+NetUpdate NetClient::handle(const uint8_t* in, int size, GameState& state) {
+    uint16_t sequence = getU16(in + 3);
+    const uint8_t* body = in + netHeaderSize;
+    int bodySize = size - netHeaderSize;
+
+    switch (in[2]) {
+    case NET_HELLO: {
+        if (bodySize != helloSize) return disconnect("the host sent a malformed greeting");
+        if (body[1] != gridSize || body[2] != playerCount || (body[0] >= playerCount && body[0] != netEverySeat && body[0] != netSpectatorSeat)) {
+            return disconnect("the host plays a different board size or player count");
+        }
+        uint64_t hash = getU32(body + 3) | static_cast<uint64_t>(getU32(body + 7)) << 32;
+        if (hash != catalogHash(rules())) {
+            return disconnect("the host plays different rules; pass the same --rules file");
+        }
+        mySeat = body[0];
+        return NET_IDLE;
+    }
+    case NET_KEYFRAME:
+        if (bodySize != static_cast<int>(sizeof(Snapshot))) return disconnect("the host sent a malformed keyframe");
+        std::memcpy(&shared, body, sizeof(shared));
+        if (!unpackSnapshot(shared, state)) return disconnect("the host sent a damaged keyframe");
+        stateSequence = sequence;
+        haveState = true;
+        awaitingKeyframe = false;
+        return NET_STATE;
+
+    case NET_DELTA: {
+        // Anything between a resync request and its keyframe is stale
+        if (awaitingKeyframe) return NET_IDLE;
+        Snapshot next = shared;
+        if (!haveState || bodySize < 4 || sequence != static_cast<uint16_t>(stateSequence + 1) ||
+            !applyDelta(next, body + 4, bodySize - 4) || snapshotChecksum(next) != getU32(body) ||
+            !unpackSnapshot(next, state)) {
+            requestKeyframe();
+            return NET_IDLE;
+        }
+        shared = next;
+        stateSequence = sequence;
+        return NET_STATE;
+    }
+    case NET_REJECT:
+        if (bodySize != 1) return disconnect("the host sent a malformed rejection");
+        rejected = static_cast<StepError>(body[0]);
+        return NET_REJECTED;
+
+    default:
+        return disconnect("the host sent an unknown message");
+    }
+}
+
+bool NetClient::send(const Action& action) {
+    if (!haveState) return false;
+    uint8_t message[netHeaderSize + 4];
+    putU32(message + netHeaderSize, ReplayRecord::of(action).bits);
+    int size = writeHeader(message, NET_ACTION, ++actionSequence, 4);
+    if (!socket.sendAll(message, size)) {
+        disconnect("the host closed the connection");
+        return false;
+    }
+    return true;
+}
+
+void NetClient::requestKeyframe() {
+    awaitingKeyframe = true;
+    resyncCount++;
+    uint8_t message[netHeaderSize];
+    if (!socket.sendAll(message, writeHeader(message, NET_RESYNC, stateSequence, 0))) {
+        disconnect("the host closed the connection");
+    }
+}
+
+NetUpdate NetClient::disconnect(const char* reason) {
+    socket.close();
+    reader.clear();
+    failure = reason;
+    return NET_DISCONNECTED;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "NetProtocol.h"
+
+#include <vector>
+
+// Greeted as this seat, a remote player plays every seat of the match
+const int netEverySeat = 0xFF;
+
+// Greeted as this seat, the remote side only watches (Spectator.h)
+const int netSpectatorSeat = 0xFE;
+
+// Most a session queues for a player who is not reading
+const int netMaxOutbound = 64 * 1024;
+
+// Writes the host's greeting for `seat` (board size, player count and a
+// hash of the rules) into `message`; returns the message size
+int writeHello(uint8_t* message, int seat);
+
+// The authoritative end of one remote player's connection (NetProtocol.h):
+// what the host's game and each room of the server hold per player.
+// Nothing here blocks on the remote side; poll() and publish() return
+// straight away. What the socket will not take yet waits in an outbound
+// queue until flush(); a player who lets more than netMaxOutbound bytes
+// pile up is hung up on.
+class NetSession {
+public:
+    NetSession();
+
+    // Takes over `connection`, made non-blocking, greets the player as
+    // `seat` (or netEverySeat) and sends `state`
+    void start(Socket&& connection, int seat, const GameState& state);
+
+    // Hangs up
+    void close();
+
+    bool connected() const {
+        return peer.isOpen();
+    }
+
+    int seat() const {
+        return remoteSeat;
+    }
+
+    // Answers resync requests and returns the next action the remote
+    // player sent, if any. Actions for another seat are refused here and
+    // never returned. Hangs up on a malformed stream.
+    bool poll(const GameState& state, Action& action);
+
+    // Tells the remote player why the last action from poll() failed
+    void reject(StepError error);
+
+    // Sends whatever changed since the last publish(), as a keyframe if
+    // the delta would not be smaller. With `answer`, an unchanged state
+    // still goes out as an empty delta, so whoever sent an action always
+    // hears back.
+    void publish(const GameState& state, bool answer = false);
+
+    // Writes out what is queued, as far as the socket takes it; false once
+    // the connection is gone
+    bool flush();
+
+    // Something is queued, so the caller should flush() once the socket
+    // is writable again
+    bool sending() const {
+        return outboundStart < outbound.size();
+    }
+
+    // For event loops that watch many connections
+    const Socket& connection() const {
+        return peer;
+    }
+
+    long long bytesSent() const {
+        return sentBytes;
+    }
+
+private:
+    Socket peer;
+    NetReader reader;
+    int remoteSeat;
+    Snapshot shared;        // the state the remote player has
+    uint16_t stateSequence;
+    uint16_t actionSequence;
+    long long sentBytes;
+    uint8_t message[netMaxMessage];
+    std::vector<uint8_t> outbound;  // bytes the socket has not taken yet, from outboundStart
+    size_t outboundStart;
+
+    void sendKeyframe(const GameState& state);
+    void send(int size);
+};
+
+// The host of a two-machine game. The host plays every seat but one on
+// its own keyboard; one remote player at a time takes `seat`.
+class NetHost {
+public:
+    NetHost() : remoteSeat(playerCount - 1) {}
+
+    bool open(uint16_t port, int seat, std::string& error);
+
+    // Hangs up on the remote player and stops listening
+    void close();
+
+    uint16_t port() const {
+        return listener.port();
+    }
+
+    int seat() const {
+        return remoteSeat;
+    }
+
+    bool connected() const {
+        return session.connected();
+    }
+
+    // Takes in a waiting player, who is sent `state`, then as
+    // NetSession::poll()
+    bool poll(const GameState& state, Action& action);
+
+    void reject(StepError error) {
+        session.reject(error);
+    }
+
+    void publish(const GameState& state) {
+        session.publish(state);
+    }
+
+    // Waits up to `milliseconds` for the remote player to send something,
+    // or for room to send what is still queued for them
+    bool waitForInput(int milliseconds);
+
+    long long bytesSent() const {
+        return session.bytesSent();
+    }
+
+private:
+    Socket listener;
+    NetSession session;
+    int remoteSeat;
+};
+
+// What NetClient::poll() found
+enum NetUpdate {
+    NET_IDLE,           // nothing new
+    NET_STATE,          // `state` now holds the host's latest position
+    NET_REJECTED,       // the host refused an action; see rejection()
+    NET_DISCONNECTED    // the host went away or the stream broke; see error()
+};
+
+// The remote end: sends this player's actions and follows the host's
+// state. seat() is netEverySeat when the host leaves every seat to it,
+// and netSpectatorSeat when the host is a spectator feed.
+// A delta that arrives out of order or does not match its checksum is
+// dropped, and a keyframe requested in its place.
+class NetClient {
+public:
+    NetClient();
+
+    // Connects and waits for the host's greeting and first keyframe
+    bool connect(const char* host, uint16_t port, GameState& state, std::string& error);
+
+    void close() {
+        disconnect("disconnected");
+    }
+
+    int seat() const {
+        return mySeat;
+    }
+
+    bool connected() const {
+        return socket.isOpen();
+    }
+
+    // Handles one message from the host; call until it returns NET_IDLE
+    NetUpdate poll(GameState& state);
+
+    // Sends an action for seat(); the host answers with a delta or a
+    // rejection
+    bool send(const Action& action);
+
+    bool waitForInput(int milliseconds) {
+        return socket.waitReadable(milliseconds);
+    }
+
+    // For event loops that watch many connections
+    const Socket& connection() const {
+        return socket;
+    }
+
+    StepError rejection() const {
+        return rejected;
+    }
+
+    const std::string& error() const {
+        return failure;
+    }
+
+    int resyncs() const {
+        return resyncCount;
+    }
+
+    long long bytesReceived() const {
+        return receivedBytes;
+    }
+
+private:
+    Socket socket;
+    NetReader reader;
+    int mySeat;
+    Snapshot shared;        // the host's state as of the last message
+    bool haveState;
+    bool awaitingKeyframe;
+    uint16_t stateSequence;
+    uint16_t actionSequence;
+    StepError rejected;
+    std::string failure;
+    int resyncCount;
+    long long receivedBytes;
+
+    NetUpdate handle(const uint8_t* message, int size, GameState& state);
+    void requestKeyframe();
+    NetUpdate disconnect(const char* reason);
+};
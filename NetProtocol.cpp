@@ -0,0 +1,126 @@
+#include "NetProtocol.h"
+
+#include <cstring>
+
+uint32_t snapshotChecksum(const Snapshot& snapshot) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&snapshot);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(Snapshot); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int encodeDelta(const Snapshot& from, const Snapshot& to, uint8_t* out, int capacity) {
+    const uint8_t* a = reinterpret_cast<const uint8_t*>(&from);
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(&to);
+    const int size = static_cast<int>(sizeof(Snapshot));
+    int length = 0;
+    int i = 0;
+    while (true) {
+        int skipped = 0;
+        while (i < size && a[i] == b[i] && skipped < 255) {
+            i++;
+            skipped++;
+        }
+        if (i == size) break;
+
+        // A long unchanged stretch is crossed in empty runs
+        int changed = 0;
+        while (i + changed < size && a[i + changed] != b[i + changed] && changed < 255) {
+            changed++;
+        }
+        if (length + 2 + changed > capacity) return -1;
+        out[length++] = static_cast<uint8_t>(skipped);
+        out[length++] = static_cast<uint8_t>(changed);
+        std::memcpy(out + length, b + i, changed);
+        length += changed;
+        i += changed;
+    }
+    return length;
+}
+
+bool applyDelta(Snapshot& snapshot, const uint8_t* runs, int size) {
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&snapshot);
+    int at = 0;
+    int i = 0;
+    while (i < size) {
+        if (i + 2 > size) return false;
+        at += runs[i];
+        int changed = runs[i + 1];
+        i += 2;
+        if (i + changed > size || at + changed > static_cast<int>(sizeof(Snapshot))) return false;
+        std::memcpy(bytes + at, runs + i, changed);
+        at += changed;
+        i += changed;
+    }
+    return true;
+}
+
+int writeHeader(uint8_t* message, NetMessageType type, uint16_t sequence, int bodySize) {
+    int size = netHeaderSize + bodySize;
+    message[0] = static_cast<uint8_t>(size);
+    message[1] = static_cast<uint8_t>(size >> 8);
+    message[2] = static_cast<uint8_t>(type);
+    message[3] = static_cast<uint8_t>(sequence);
+    message[4] = static_cast<uint8_t>(sequence >> 8);
+    return size;
+}
+
+void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> 8 * i);
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+uint16_t getU16(const uint8_t* in) {
+    return static_cast<uint16_t>(in[0] | in[1] << 8);
+}
+
+NetReader::NetReader() {
+    clear();
+}
+
+void NetReader::clear() {
+    start = 0;
+    end = 0;
+    bad = false;
+}
+
+bool NetReader::fill(Socket& socket) {
+    // Move a partial message to the front so a whole one always fits
+    if (start > 0) {
+        std::memmove(buffer, buffer + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    // Messages that arrived just before the peer hung up are still handed
+    // out; the close is reported by the next fill. A short read means the
+    // socket is drained, which saves asking again only to hear so.
+    int before = end;
+    while (end < static_cast<int>(sizeof(buffer))) {
+        int room = static_cast<int>(sizeof(buffer)) - end;
+        int got = socket.receive(buffer + end, room);
+        if (got < 0) return end > before;
+        end += got;
+        if (got < room) break;
+    }
+    return true;
+}
+
+const uint8_t* NetReader::next(int& size) {
+    if (bad || end - start < netHeaderSize) return nullptr;
+    size = getU16(buffer + start);
+    if (size < netHeaderSize || size > netMaxMessage) {
+        bad = true;
+        return nullptr;
+    }
+    if (end - start < size) return nullptr;
+    const uint8_t* message = buffer + start;
+    start += size;
+    return message;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Replay.h"
+#include "Snapshot.h"
+#include "Socket.h"
+
+#include <cstdint>
+
+// Wire format for network play. The host owns the match; the remote
+// player only sends its inputs, as ReplayRecords, and gets back what they
+// changed. A change goes out as a delta between the Snapshot the client
+// already has and the new one, which for an ordinary move is a few bytes.
+//
+// Every message starts with the same header, little-endian:
+//
+//     0  u16 size of the whole message, header included
+//     2  u8  NetMessageType
+//     3  u16 sequence number
+//
+// followed by the body listed with each type. States are numbered from
+// the last keyframe, so a client notices a lost or repeated delta, and
+// every delta carries a checksum of the snapshot it produces.
+
+enum NetMessageType {
+    NET_HELLO,      // host: u8 seat, u8 board size, u8 player count, u64 catalogHash()
+    NET_KEYFRAME,   // host: the whole Snapshot; restarts the sequence at its number
+    NET_DELTA,      // host: u32 snapshotChecksum() of the result, then runs (see encodeDelta)
+    NET_ACTION,     // client: u32 ReplayRecord bits, numbered by the client
+    NET_REJECT,     // host: u8 StepError for the client action with this number
+    NET_RESYNC      // client: send a keyframe, the last delta did not add up
+};
+
+const int netHeaderSize = 5;
+const int netMaxMessage = netHeaderSize + static_cast<int>(sizeof(Snapshot));
+
+static_assert(netMaxMessage <= 65535, "message sizes are 16 bits");
+
+// FNV-1a over the snapshot's bytes
+uint32_t snapshotChecksum(const Snapshot& snapshot);
+
+// Writes the changes from `from` to `to` as runs of [u8 bytes skipped]
+// [u8 bytes changed][the changed bytes] and returns their length, or -1 if
+// they would not fit in `capacity` bytes (send a keyframe instead)
+int encodeDelta(const Snapshot& from, const Snapshot& to, uint8_t* out, int capacity);
+
+// Applies encodeDelta() runs to `snapshot`; false if they run off its end
+bool applyDelta(Snapshot& snapshot, const uint8_t* runs, int size);
+
+// Writes a header at the start of `message` for a body of `bodySize`
+// bytes and returns the size of the whole message
+int writeHeader(uint8_t* message, NetMessageType type, uint16_t sequence, int bodySize);
+
+void putU32(uint8_t* out, uint32_t value);
+uint32_t getU32(const uint8_t* in);
+uint16_t getU16(const uint8_t* in);
+
+// Splits the byte stream from a socket into whole messages, in a fixed
+// buffer so reading never allocates
+class NetReader {
+public:
+    NetReader();
+
+    void clear();
+
+    // Reads whatever has arrived from a non-blocking socket; false once
+    // the connection is gone
+    bool fill(Socket& socket);
+
+    // The next complete message, or null until more bytes arrive. Also
+    // null, with broken() set, if the stream holds a malformed header.
+    const uint8_t* next(int& size);
+
+    bool broken() const {
+        return bad;
+    }
+
+private:
+    uint8_t buffer[2 * netMaxMessage];
+    int start;
+    int end;
+    bool bad;
+};
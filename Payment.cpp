@@ -0,0 +1,61 @@
+#include "Payment.h"
+
+namespace {
+
+// Coins of `coinValue` needed to cover `cost` on their own
+int coinsToCover(int cost, int coinValue) {
+    return cost > 0 ? (cost + coinValue - 1) / coinValue : 0;
+}
+
+Payment bestPayment(int cost, Currency currency, int gold, int silver) {
+    Payment best = { -1, 0 };
+    int bestOverpay = 0;
+    if (currency == PAY_SILVER) gold = 0;
+
+    // Fewest gold coins first, so ties keep the gold
+    for (int g = 0; g <= gold; g++) {
+        int s = coinsToCover(cost - g * GOLD_COIN_POINTS, SILVER_COIN_POINTS);
+        if (currency == PAY_GOLD && s > 0) continue;
+        if (s > silver) continue;
+
+        int overpay = g * GOLD_COIN_POINTS + s * SILVER_COIN_POINTS - cost;
+        if (!best.affordable() || overpay < bestOverpay) {
+            best = { static_cast<int8_t>(g), static_cast<int8_t>(s) };
+            bestOverpay = overpay;
+        }
+    }
+    return best;
+}
+
+}
+
+PaymentTable activePayments = [] {
+    PaymentTable table;
+    table.build(defaultCatalog());
+    return table;
+}();
+
+void PaymentTable::build(const Catalog& catalog) {
+    for (int price = 0; price < priceCount; price++) {
+        int cost;
+        Currency currency;
+        if (price < itemTypeCount) {
+            cost = catalog.items[price].cost;
+            currency = catalog.items[price].currency;
+        }
+        else {
+            cost = catalog.hurdles[price - itemTypeCount].cost;
+            currency = catalog.hurdles[price - itemTypeCount].currency;
+        }
+
+        PriceTable& table = prices[price];
+        table.maxGold = currency == PAY_SILVER ? 0 : coinsToCover(cost, GOLD_COIN_POINTS);
+        table.maxSilver = currency == PAY_GOLD ? 0 : coinsToCover(cost, SILVER_COIN_POINTS);
+        table.payments.resize((table.maxGold + 1) * (table.maxSilver + 1));
+        for (int g = 0; g <= table.maxGold; g++) {
+            for (int s = 0; s <= table.maxSilver; s++) {
+                table.payments[g * (table.maxSilver + 1) + s] = bestPayment(cost, currency, g, s);
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Catalog.h"
+
+#include <cstdint>
+#include <vector>
+
+// The coins a purchase actually takes. Every price in the catalog gets a
+// table of the best payment from each wallet it can come from, worked out
+// once whenever the rules change, so paying and "can I afford this" are a
+// single lookup.
+//
+// The best payment is the one that overpays least; when several do, the
+// one that gives up the fewest gold coins.
+
+struct Payment {
+    int8_t gold, silver;    // coins handed over; gold is -1 if the price is out of reach
+
+    bool affordable() const { return gold >= 0; }
+
+    int value() const {
+        return gold * GOLD_COIN_POINTS + silver * SILVER_COIN_POINTS;
+    }
+};
+
+// Price slots: one per ItemType, then one per HurdleType
+const int priceCount = itemTypeCount + hurdleTypeCount;
+
+inline int itemPrice(ItemType item) {
+    return item;
+}
+
+inline int hurdlePrice(HurdleType hurdle) {
+    return itemTypeCount + hurdle;
+}
+
+class PaymentTable {
+public:
+    void build(const Catalog& catalog);
+
+    Payment lookup(int price, int gold, int silver) const {
+        const PriceTable& table = prices[price];
+
+        // A wallet never needs more coins of a kind than would cover the
+        // price on their own, so bigger wallets pay like the biggest one
+        // in the table.
+        if (gold > table.maxGold) gold = table.maxGold;
+        if (silver > table.maxSilver) silver = table.maxSilver;
+        if (gold < 0 || silver < 0) return { -1, 0 };
+        return table.payments[gold * (table.maxSilver + 1) + silver];
+    }
+
+private:
+    struct PriceTable {
+        int maxGold, maxSilver;
+        std::vector<Payment> payments;  // by gold held, then silver held
+    };
+
+    PriceTable prices[priceCount];
+};
+
+// Payments for the active rules; setRules() keeps it in step
+extern PaymentTable activePayments;
+
+inline const PaymentTable& payments() {
+    return activePayments;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+// Fixed-capacity slot allocator. Slots are handed out and given back in
+// O(1) through a free list, most recently released first, and a slot
+// number stays valid for as long as it is live: nothing is moved or
+// evicted to make room. Storage is inline, so a pool copies along with the
+// state that holds it and never touches the heap.
+template <int Capacity>
+class SlotPool {
+public:
+    static const int capacity = Capacity;
+
+    SlotPool() {
+        clear();
+    }
+
+    void clear() {
+        used = 0;
+        freeCount = 0;
+        for (int i = 0; i < Capacity; i++) {
+            live[i] = 0;
+        }
+    }
+
+    // A new slot, or -1 if every slot is taken
+    int acquire() {
+        int slot;
+        if (freeCount > 0) {
+            slot = freeList[--freeCount];
+        }
+        else if (used < Capacity) {
+            slot = used++;
+        }
+        else {
+            return -1;
+        }
+        live[slot] = 1;
+        return slot;
+    }
+
+    void release(int slot) {
+        live[slot] = 0;
+        freeList[freeCount++] = static_cast<int16_t>(slot);
+    }
+
+    bool full() const {
+        return freeCount == 0 && used == Capacity;
+    }
+
+    bool isLive(int slot) const {
+        return live[slot] != 0;
+    }
+
+    // Every slot ever handed out is below end(); loops over the pool stop there
+    int end() const {
+        return used;
+    }
+
+    // Released slots waiting for reuse, oldest first
+    int freeSlotCount() const {
+        return freeCount;
+    }
+
+    int freeSlot(int i) const {
+        return freeList[i];
+    }
+
+private:
+    int16_t freeList[Capacity];
+    int16_t freeCount;
+    int16_t used;
+    uint8_t live[Capacity];
+};
@@ -0,0 +1,240 @@
+#include "Replay.h"
+#include "Catalog.h"
+
+#include <algorithm>
+#include <cstring>
+
+// replayMagic as written by a host of the other byte order
+const uint32_t swappedReplayMagic = 0x41515250;
+
+// Records start right after the header and keyframes on the next 8-byte
+// boundary after the records
+static size_t keyframeOffset(uint32_t recordCount) {
+    size_t end = sizeof(ReplayHeader) + recordCount * sizeof(ReplayRecord);
+    return (end + 7) / 8 * 8;
+}
+
+// Keyframes are held ahead of time so recording a long match stays off
+// the heap
+const int reservedKeyframes = 512;
+
+ReplayRecord ReplayRecord::of(const Action& action) {
+    int cell = action.type == ACTION_PLACE_HURDLE ? cellIndex(action.x, action.y) : 0;
+    return { static_cast<uint32_t>(action.type) | static_cast<uint32_t>(action.player) << 2 |
+        static_cast<uint32_t>(action.item) << 5 | static_cast<uint32_t>(cell) << 8 };
+}
+
+ReplayRecord ReplayRecord::selectPlayer(int player) {
+    return { static_cast<uint32_t>(REPLAY_SELECT_PLAYER) | static_cast<uint32_t>(player) << 2 };
+}
+
+Action ReplayRecord::action() const {
+    switch (kind()) {
+    case REPLAY_BUY_ITEM:
+        return Action::buyItem(player(), static_cast<ItemType>(item()));
+    case REPLAY_PLACE_HURDLE:
+        return Action::placeHurdle(player(), static_cast<HurdleType>(item()), cell() % gridSize, cell() / gridSize);
+    default:
+        return Action::move(player());
+    }
+}
+
+ReplayRecorder::ReplayRecorder() : file(nullptr), interval(replayKeyframeInterval) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+ReplayRecorder::~ReplayRecorder() {
+    finish();
+}
+
+bool ReplayRecorder::open(const char* path, uint64_t seed, int keyframeInterval, std::string& error) {
+    finish();
+    file = std::fopen(path, "wb");
+    if (!file) {
+        error = std::string(path) + ": cannot create replay";
+        return false;
+    }
+    std::setvbuf(file, buffer, _IOFBF, sizeof(buffer));
+
+    std::memset(&header, 0, sizeof(header));
+    header.magic = replayMagic;
+    header.version = replayVersion;
+    header.boardSize = static_cast<uint16_t>(Board::size);
+    header.playerCount = static_cast<uint16_t>(playerCount);
+    header.keyframeInterval = static_cast<uint16_t>(keyframeInterval);
+    header.keyframeSize = sizeof(ReplayKeyframe);
+    header.seed = seed;
+    header.rulesHash = catalogHash(rules());
+    interval = keyframeInterval;
+
+    keyframes.clear();
+    keyframes.reserve(reservedKeyframes);
+
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        std::fclose(file);
+        file = nullptr;
+        error = std::string(path) + ": cannot write replay";
+        return false;
+    }
+    return true;
+}
+
+// Writes the record; returns the keyframe to fill in if one is due
+ReplayKeyframe* ReplayRecorder::append(ReplayRecord input) {
+    if (!file) return nullptr;
+
+    std::fwrite(&input, sizeof(input), 1, file);
+    header.recordCount++;
+    if (input.kind() != REPLAY_MOVE) return nullptr;
+
+    header.turnCount++;
+    if (interval <= 0 || header.turnCount % interval != 0) return nullptr;
+
+    // A crash loses at most the moves since the last keyframe
+    std::fflush(file);
+
+    keyframes.emplace_back();
+    ReplayKeyframe& keyframe = keyframes.back();
+    std::memset(static_cast<void*>(&keyframe), 0, sizeof(keyframe));    // padding is written too
+    keyframe.record = header.recordCount;
+    keyframe.turn = header.turnCount;
+    return &keyframe;
+}
+
+void ReplayRecorder::record(ReplayRecord input, const GameState& after) {
+    if (ReplayKeyframe* keyframe = append(input)) {
+        toBitboard(after, keyframe->state);
+    }
+}
+
+void ReplayRecorder::record(ReplayRecord input, const BitboardState& after) {
+    if (ReplayKeyframe* keyframe = append(input)) {
+        keyframe->state = after;
+    }
+}
+
+bool ReplayRecorder::finish() {
+    if (!file) return true;
+
+    // The counts reach the disk before anything follows the records, so a
+    // file cut short while the keyframes go out still reads as exactly
+    // its records (see ReplayFile::open)
+    static const char padding[8] = {};
+    size_t recordsEnd = sizeof(ReplayHeader) + header.recordCount * sizeof(ReplayRecord);
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fflush(file);
+    std::fseek(file, static_cast<long>(recordsEnd), SEEK_SET);
+    std::fwrite(padding, 1, keyframeOffset(header.recordCount) - recordsEnd, file);
+    if (!keyframes.empty()) {
+        std::fwrite(keyframes.data(), sizeof(ReplayKeyframe), keyframes.size(), file);
+    }
+
+    header.keyframeCount = static_cast<uint32_t>(keyframes.size());
+    header.complete = 1;
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    bool ok = !std::ferror(file);
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+ReplayFile::ReplayFile() : head(nullptr), records(0), turns(0) {}
+
+bool ReplayFile::open(const char* path, std::string& error) {
+    head = nullptr;
+    if (!mapping.open(path, error)) return false;
+
+    const ReplayHeader* h = reinterpret_cast<const ReplayHeader*>(mapping.data());
+    if (mapping.size() >= sizeof(ReplayHeader) && h->magic == swappedReplayMagic) {
+        error = std::string(path) + ": recorded on a machine of the other byte order";
+        return false;
+    }
+    if (mapping.size() < sizeof(ReplayHeader) || h->magic != replayMagic) {
+        error = std::string(path) + ": not a replay file";
+        return false;
+    }
+    if (h->version != replayVersion) {
+        error = std::string(path) + ": replay version " + std::to_string(h->version) + " is not supported";
+        return false;
+    }
+    if (h->boardSize != Board::size || h->playerCount != playerCount || h->keyframeSize != sizeof(ReplayKeyframe)) {
+        error = std::string(path) + ": recorded on a " + std::to_string(h->boardSize) + "x" + std::to_string(h->boardSize) +
+            " board for " + std::to_string(h->playerCount) + " players by a different build";
+        return false;
+    }
+
+    if (h->complete) {
+        size_t end = keyframeOffset(h->recordCount) + h->keyframeCount * sizeof(ReplayKeyframe);
+        if (mapping.size() < end) {
+            error = std::string(path) + ": replay is truncated";
+            return false;
+        }
+        records = static_cast<int>(h->recordCount);
+        turns = static_cast<int>(h->turnCount);
+    }
+    else {
+        // Cut short before finish() was done: whatever whole records
+        // reached the disk, counted once here. Only records follow the
+        // header until finish() has written the record count, which then
+        // stops the padding and keyframes being read as records.
+        size_t whole = (mapping.size() - sizeof(ReplayHeader)) / sizeof(ReplayRecord);
+        if (h->recordCount > 0) whole = std::min(whole, static_cast<size_t>(h->recordCount));
+        records = static_cast<int>(whole);
+        const ReplayRecord* data = recordData();
+        turns = static_cast<int>(std::count_if(data, data + records,
+            [](ReplayRecord r) { return r.kind() == REPLAY_MOVE; }));
+    }
+    head = h;
+    return true;
+}
+
+const ReplayRecord* ReplayFile::recordData() const {
+    return reinterpret_cast<const ReplayRecord*>(mapping.data() + sizeof(ReplayHeader));
+}
+
+const ReplayKeyframe* ReplayFile::keyframeData() const {
+    return reinterpret_cast<const ReplayKeyframe*>(mapping.data() + keyframeOffset(head->recordCount));
+}
+
+bool applyRecord(GameState& state, ReplayRecord record) {
+    if (record.kind() == REPLAY_SELECT_PLAYER) {
+        state.currentPlayer = record.player();
+        return true;
+    }
+    return step(state, record.action()).ok();
+}
+
+bool seekReplay(const ReplayFile& replay, int turn, GameState& state) {
+    if (turn < 0 || turn > replay.turnCount()) return false;
+
+    // Last keyframe at or before the turn, if any
+    const ReplayKeyframe* first = replay.keyframeData();
+    const ReplayKeyframe* last = first + replay.keyframeCount();
+    const ReplayKeyframe* keyframe = std::upper_bound(first, last, turn,
+        [](int t, const ReplayKeyframe& k) { return t < static_cast<int>(k.turn); });
+
+    int next = 0;
+    int moves = 0;
+    if (keyframe != first) {
+        --keyframe;
+        fromBitboard(keyframe->state, state);
+        next = static_cast<int>(keyframe->record);
+        moves = static_cast<int>(keyframe->turn);
+    }
+    else {
+        newGame(state, replay.header().seed);
+    }
+
+    const ReplayRecord* records = replay.recordData();
+    for (; next < replay.recordCount(); next++) {
+        if (records[next].kind() == REPLAY_MOVE) {
+            if (moves == turn) break;
+            moves++;
+        }
+        if (!applyRecord(state, records[next])) return false;
+    }
+    return moves == turn;
+}
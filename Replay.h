@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Bitboard.h"
+#include "GameEngine.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary match recordings. A replay is the board seed plus one 32-bit
+// record per accepted input; newGame() and step() are deterministic, so
+// playing the records back rebuilds every state of the match. Every
+// keyframeInterval moves the whole state is stored as well, so a viewer
+// can jump to any turn by replaying at most that many moves.
+//
+// File layout, in the recording machine's byte order (keyframes are
+// states read in place, so nothing is converted; ReplayFile spots a
+// replay from a host of the other byte order by its magic):
+//
+//     ReplayHeader
+//     ReplayRecord   records[recordCount]
+//     (padding to 8 bytes)
+//     ReplayKeyframe keyframes[keyframeCount]
+//
+// Every part has a fixed layout, so ReplayFile reads a mapped file in
+// place. Keyframes are only written by finish(); a recording that was cut
+// short still replays from its records, just without seeking shortcuts.
+
+const uint32_t replayMagic = 0x50525141;    // "AQRP"
+const uint16_t replayVersion = 1;
+const int replayKeyframeInterval = 16;
+
+enum ReplayKind {
+    REPLAY_MOVE,            // step(Action::move(player))
+    REPLAY_BUY_ITEM,        // step(Action::buyItem(player, item))
+    REPLAY_PLACE_HURDLE,    // step(Action::placeHurdle(player, item, cell))
+    REPLAY_SELECT_PLAYER    // the window made `player` the one who shops
+};
+
+static_assert(playerCount <= 8 && hurdleTypeCount <= 8 && itemTypeCount <= 8, "ReplayRecord packs these into 3 bits");
+static_assert(Board::cellCount <= 65536, "ReplayRecord packs cells into 16 bits");
+
+// One input: kind in bits 0-1, player in bits 2-4, item or hurdle type in
+// bits 5-7 and the target cell (see cellIndex) in bits 8-23
+struct ReplayRecord {
+    uint32_t bits;
+
+    static ReplayRecord of(const Action& action);
+    static ReplayRecord selectPlayer(int player);
+
+    // The step() input a move, purchase or placement record stands for
+    Action action() const;
+
+    ReplayKind kind() const { return static_cast<ReplayKind>(bits & 3); }
+    int player() const { return bits >> 2 & 7; }
+    int item() const { return bits >> 5 & 7; }
+    int cell() const { return bits >> 8 & 0xFFFF; }
+};
+
+static_assert(sizeof(ReplayRecord) == 4, "records are read in place");
+
+struct ReplayHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t boardSize;         // Board::size and playerCount the match was played with
+    uint16_t playerCount;
+    uint16_t keyframeInterval;
+    uint32_t keyframeSize;      // sizeof(ReplayKeyframe) of the recording build
+    uint64_t seed;
+    uint64_t rulesHash;         // catalogHash() of the rules played
+    uint32_t recordCount;       // these three are 0 until finish(), which writes
+                                // recordCount and turnCount before the keyframes
+    uint32_t keyframeCount;
+    uint32_t turnCount;
+    uint32_t complete;
+};
+
+// The state right after move `turn`, before any of the later records
+struct ReplayKeyframe {
+    uint32_t record;    // first record after the keyframe
+    uint32_t turn;
+    BitboardState state;
+};
+
+// Appends records to a replay file as the match goes. Records go straight
+// to disk through a fixed buffer; keyframes are held until finish().
+class ReplayRecorder {
+public:
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    // Starts a recording of the board newGame(state, seed) lays out
+    bool open(const char* path, uint64_t seed, int keyframeInterval, std::string& error);
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Logs an input that was accepted; `after` is the state it produced
+    void record(ReplayRecord input, const GameState& after);
+    void record(ReplayRecord input, const BitboardState& after);
+
+    // Writes the keyframes and the final counts. Also done on destruction.
+    bool finish();
+
+private:
+    std::FILE* file;
+    ReplayHeader header;
+    int interval;
+    std::vector<ReplayKeyframe> keyframes;
+    char buffer[4096];
+
+    ReplayKeyframe* append(ReplayRecord input);
+};
+
+// A replay file mapped read-only; the header, records and keyframes point
+// into the mapping.
+class ReplayFile {
+public:
+    ReplayFile();
+
+    // Fails if the file is not a replay or was recorded on a host of the
+    // other byte order or by a build with a different board size, player
+    // count or state layout
+    bool open(const char* path, std::string& error);
+
+    const ReplayHeader& header() const {
+        return *head;
+    }
+
+    int recordCount() const { return records; }
+    int keyframeCount() const { return static_cast<int>(head->keyframeCount); }
+    int turnCount() const { return turns; }
+
+    const ReplayRecord* recordData() const;
+    const ReplayKeyframe* keyframeData() const;
+
+private:
+    MappedFile mapping;
+    const ReplayHeader* head;
+    int records;
+    int turns;
+};
+
+// Applies one record exactly as the recording game did. Returns false if
+// step() refused it, which means the replay does not fit these rules.
+bool applyRecord(GameState& state, ReplayRecord record);
+
+// Rebuilds the state after move `turn` and whatever followed it before
+// the next move, starting from the nearest keyframe. Returns false if the
+// replay is shorter or a record is refused.
+bool seekReplay(const ReplayFile& replay, int turn, GameState& state);
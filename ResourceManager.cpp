@@ -0,0 +1,6 @@
+#include "ResourceManager.h"
+
+ResourceManager& ResourceManager::instance() {
+    static ResourceManager manager;
+    return manager;
+}
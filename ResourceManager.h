@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Loads each asset file once and hands out shared handles to it.
+// preload() starts the disk read on a background thread so the window can
+// come up straight away; get() waits for it if it is still in flight.
+// A file that fails to load is reported once and replaced by an empty
+// resource, so callers never get a null handle and never retry the read.
+template <typename T>
+class ResourceCache {
+public:
+    typedef std::shared_ptr<const T> Handle;
+
+    void preload(const std::string& path) {
+        request(path, std::launch::async);
+    }
+
+    Handle get(const std::string& path) {
+        return request(path, std::launch::deferred).get();
+    }
+
+    // True once every preloaded file has finished loading
+    bool ready() {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& entry : entries) {
+            if (entry.second.wait_for(std::chrono::seconds(0)) == std::future_status::timeout) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::mutex lock;
+    std::map<std::string, std::shared_future<Handle>> entries;
+
+    std::shared_future<Handle> request(const std::string& path, std::launch policy) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = entries.find(path);
+        if (found != entries.end()) {
+            return found->second;
+        }
+        std::shared_future<Handle> pending = std::async(policy, &ResourceCache::load, path).share();
+        entries[path] = pending;
+        return pending;
+    }
+
+    static Handle load(const std::string& path) {
+        std::shared_ptr<T> resource = std::make_shared<T>();
+        if (!resource->loadFromFile(path)) {
+            std::cerr << "Missing asset: " << path << " (continuing without it)" << std::endl;
+        }
+        return resource;
+    }
+};
+
+// Process-wide asset store shared by every part of the window client
+class ResourceManager {
+public:
+    ResourceCache<sf::Font> fonts;
+    ResourceCache<sf::Texture> textures;
+
+    static ResourceManager& instance();
+
+    bool ready() {
+        return fonts.ready() && textures.ready();
+    }
+
+private:
+    ResourceManager() {}
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+// xoshiro256** generator. Every game owns one, so boards can be rebuilt
+// exactly from their seed and parallel simulations share no RNG state.
+
+class Rng {
+public:
+    Rng() { seed(0); }
+    explicit Rng(uint64_t seedValue) { seed(seedValue); }
+
+    // Independent stream `stream` of the generator family for `seedValue`,
+    // e.g. one per simulated game.
+    Rng(uint64_t seedValue, uint64_t stream) { seed(seedValue ^ splitMix(stream + 0x632BE59BD9B4E019ULL)); }
+
+    void seed(uint64_t seedValue) {
+        uint64_t x = seedValue;
+        for (int i = 0; i < 4; i++) {
+            x += 0x9E3779B97F4A7C15ULL;
+            s[i] = splitMix(x);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform value in [0, bound)
+    int below(int bound) {
+        return static_cast<int>(((next() >> 32) * static_cast<uint64_t>(bound)) >> 32);
+    }
+
+    // Advances the generator by 2^128 steps; calling it k times gives the
+    // start of the k-th non-overlapping subsequence.
+    void jump() {
+        static const uint64_t JUMP[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+            0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (JUMP[i] & (1ULL << b)) {
+                    for (int k = 0; k < 4; k++) t[k] ^= s[k];
+                }
+                next();
+            }
+        }
+        for (int k = 0; k < 4; k++) s[k] = t[k];
+    }
+
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static uint64_t splitMix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
@@ -0,0 +1,101 @@
+#include "Catalog.h"
+#include "GameServer.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Headless match server: hosts a room per connection until interrupted,
+// printing a line of counters every few seconds.
+
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void onSignal(int) {
+    interrupted = 1;
+}
+
+static void printUsage() {
+    std::cout << "Usage: Server [--port N] [--threads N] [--rooms N] [--seconds N] [--seed N] [--rules FILE]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    int seconds = 0;    // 0 = until interrupted
+    const int reportSeconds = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--help") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (!value) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if (std::strcmp(arg, "--port") == 0) config.port = static_cast<uint16_t>(std::atoi(value));
+        else if (std::strcmp(arg, "--threads") == 0) config.threads = std::atoi(value);
+        else if (std::strcmp(arg, "--rooms") == 0) config.rooms = std::atoi(value);
+        else if (std::strcmp(arg, "--seconds") == 0) seconds = std::atoi(value);
+        else if (std::strcmp(arg, "--seed") == 0) config.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--rules") == 0) {
+            Catalog catalog;
+            std::string error;
+            if (!loadCatalog(value, catalog, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            setRules(catalog);
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        i++;
+    }
+
+    if (config.rooms < 1) {
+        std::cerr << "--rooms must be at least 1" << std::endl;
+        return 1;
+    }
+
+    GameServer server(config);
+    std::string error;
+    if (!server.start(error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::cout << "Serving up to " << config.rooms << " rooms on port " << server.port() << " with " << server.threads()
+        << " thread(s); open file limit " << Socket::raiseOpenLimit() << std::endl;
+
+    auto started = std::chrono::steady_clock::now();
+    auto reported = started;
+    long long reportedActions = 0;
+    while (!interrupted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = std::chrono::steady_clock::now();
+        bool done = seconds > 0 && now - started >= std::chrono::seconds(seconds);
+        if (now - reported < std::chrono::seconds(reportSeconds) && !done) continue;
+
+        ServerStats stats = server.stats();
+        std::chrono::duration<double> elapsed = now - reported;
+        std::cout << stats.openRooms << " open rooms, " << stats.sessions << " sessions, " << stats.refused << " refused, "
+            << stats.matches << " matches, " << static_cast<long long>((stats.actions - reportedActions) / elapsed.count())
+            << " actions/s" << std::endl;
+        reported = now;
+        reportedActions = stats.actions;
+        if (done) break;
+    }
+
+    server.stop();
+    return 0;
+}
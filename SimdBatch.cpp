@@ -0,0 +1,238 @@
+#include "SimdBatch.h"
+#include "Catalog.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+struct Vec {
+    __m256i v;
+};
+
+static inline Vec load(const int32_t* p) { return { _mm256_load_si256(reinterpret_cast<const __m256i*>(p)) }; }
+static inline void store(int32_t* p, Vec a) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), a.v); }
+static inline Vec splat(int32_t x) { return { _mm256_set1_epi32(x) }; }
+static inline Vec add(Vec a, Vec b) { return { _mm256_add_epi32(a.v, b.v) }; }
+static inline Vec sub(Vec a, Vec b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+static inline Vec and_(Vec a, Vec b) { return { _mm256_and_si256(a.v, b.v) }; }
+static inline Vec or_(Vec a, Vec b) { return { _mm256_or_si256(a.v, b.v) }; }
+static inline Vec andnot(Vec a, Vec b) { return { _mm256_andnot_si256(a.v, b.v) }; }     // ~a & b
+static inline Vec eq(Vec a, Vec b) { return { _mm256_cmpeq_epi32(a.v, b.v) }; }
+static inline Vec gt(Vec a, Vec b) { return { _mm256_cmpgt_epi32(a.v, b.v) }; }
+static inline Vec select(Vec mask, Vec a, Vec b) { return { _mm256_blendv_epi8(b.v, a.v, mask.v) }; }
+static inline Vec gather(const int32_t* table, Vec index) { return { _mm256_i32gather_epi32(table, index.v, 4) }; }
+static inline bool any(Vec mask) { return _mm256_movemask_epi8(mask.v) != 0; }
+
+const char* simdKernelName() { return "AVX2"; }
+
+#else
+
+struct Vec {
+    int32_t v[simdLanes];
+};
+
+#define LANEWISE(expr) Vec r; for (int l = 0; l < simdLanes; l++) r.v[l] = (expr); return r
+
+static inline Vec load(const int32_t* p) { Vec r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+static inline void store(int32_t* p, Vec a) { std::memcpy(p, a.v, sizeof(a.v)); }
+static inline Vec splat(int32_t x) { LANEWISE(x); }
+static inline Vec add(Vec a, Vec b) { LANEWISE(a.v[l] + b.v[l]); }
+static inline Vec sub(Vec a, Vec b) { LANEWISE(a.v[l] - b.v[l]); }
+static inline Vec and_(Vec a, Vec b) { LANEWISE(a.v[l] & b.v[l]); }
+static inline Vec or_(Vec a, Vec b) { LANEWISE(a.v[l] | b.v[l]); }
+static inline Vec andnot(Vec a, Vec b) { LANEWISE(~a.v[l] & b.v[l]); }
+static inline Vec eq(Vec a, Vec b) { LANEWISE(a.v[l] == b.v[l] ? -1 : 0); }
+static inline Vec gt(Vec a, Vec b) { LANEWISE(a.v[l] > b.v[l] ? -1 : 0); }
+static inline Vec select(Vec mask, Vec a, Vec b) { LANEWISE(mask.v[l] ? a.v[l] : b.v[l]); }
+static inline Vec gather(const int32_t* table, Vec index) { LANEWISE(table[index.v[l]]); }
+static inline bool any(Vec mask) {
+    for (int l = 0; l < simdLanes; l++) if (mask.v[l]) return true;
+    return false;
+}
+
+#undef LANEWISE
+
+const char* simdKernelName() { return "scalar"; }
+
+#endif
+
+// Cell index of every path step, per player, as 32-bit lanes for gather
+struct PathCells {
+    int32_t cells[playerCount][pathLen];
+
+    PathCells() {
+        for (int p = 0; p < playerCount; p++) {
+            for (int i = 0; i < pathLen; i++) {
+                cells[p][i] = Board::pathCell(p, i);
+            }
+        }
+    }
+};
+
+static const PathCells pathCells;
+
+void clearBatch(SimdBatch& batch) {
+    std::memset(&batch, 0, sizeof(batch));
+    for (int l = 0; l < simdLanes; l++) {
+        batch.gameOver[l] = -1;
+    }
+}
+
+void packLane(SimdBatch& batch, int lane, const GameState& state) {
+    for (int p = 0; p < playerCount; p++) {
+        const PlayerState& player = state.players[p];
+        batch.pos[p][lane] = player.pos;
+        batch.skipTurns[p][lane] = player.skipTurns;
+        batch.goldCoins[p][lane] = player.goldCoins;
+        batch.silverCoins[p][lane] = player.silverCoins;
+        batch.score[p][lane] = player.score;
+        for (int i = 0; i < itemTypeCount; i++) {
+            batch.items[i][p][lane] = player.items[i];
+        }
+        batch.atGoal[p][lane] = player.atGoal ? -1 : 0;
+    }
+    for (int c = 0; c < coinCount; c++) {
+        batch.coinCell[c][lane] = state.coins.cell[c];
+        batch.coinGold[c][lane] = state.coins.type[c] == GOLD ? -1 : 0;
+        batch.coinLive[c][lane] = c < state.coins.end() && state.coins.isLive(c) ? -1 : 0;
+    }
+    for (int h = 0; h < hurdleCount; h++) {
+        batch.hurdleCell[h][lane] = state.hurdles.cell[h];
+        batch.hurdleType[h][lane] = state.hurdles.type[h];
+        batch.hurdleLive[h][lane] = h < state.hurdles.end() && state.hurdles.isLive(h) ? -1 : 0;
+    }
+    batch.gameOver[lane] = state.gameOver ? -1 : 0;
+}
+
+void unpackLane(const SimdBatch& batch, int lane, GameState& state) {
+    state = GameState();
+    for (int p = 0; p < playerCount; p++) {
+        PlayerState& player = state.players[p];
+        player.pos = batch.pos[p][lane];
+        player.skipTurns = batch.skipTurns[p][lane];
+        player.goldCoins = batch.goldCoins[p][lane];
+        player.silverCoins = batch.silverCoins[p][lane];
+        player.score = batch.score[p][lane];
+        for (int i = 0; i < itemTypeCount; i++) {
+            player.items[i] = batch.items[i][p][lane];
+        }
+        player.atGoal = batch.atGoal[p][lane] != 0;
+    }
+    for (int c = 0; c < coinCount; c++) {
+        state.coins.add(batch.coinCell[c][lane], batch.coinGold[c][lane] ? GOLD : SILVER);
+    }
+    for (int h = 0; h < hurdleCount; h++) {
+        state.hurdles.add(batch.hurdleCell[h][lane], batch.hurdleType[h][lane]);
+    }
+    for (int c = 0; c < coinCount; c++) {
+        if (!batch.coinLive[c][lane]) state.coins.remove(c);
+    }
+    for (int h = 0; h < hurdleCount; h++) {
+        if (!batch.hurdleLive[h][lane]) state.hurdles.remove(h);
+    }
+    state.gameOver = batch.gameOver[lane] != 0;
+    rebuildOccupancy(state);
+}
+
+bool allLanesOver(const SimdBatch& batch) {
+    return !any(andnot(load(batch.gameOver), splat(-1)));
+}
+
+void stepMoves(SimdBatch& b, int mover) {
+    const Vec zero = splat(0);
+    const Vec active = andnot(load(b.gameOver), splat(-1));
+    if (!any(active)) return;
+
+    store(b.turns, sub(load(b.turns), active));
+
+    // PlayerState::move. Masks are -1, so subtracting a mask adds one.
+    {
+        Vec skip = load(b.skipTurns[mover]);
+        Vec pos = load(b.pos[mover]);
+        Vec skipping = and_(active, gt(skip, zero));
+        Vec advancing = andnot(skipping, and_(active, gt(splat(pathLen - 1), pos)));
+        skip = add(skip, skipping);
+        pos = sub(pos, advancing);
+        Vec reached = and_(advancing, eq(gather(pathCells.cells[mover], pos), splat(Board::goalCell)));
+        store(b.skipTurns[mover], skip);
+        store(b.pos[mover], pos);
+        store(b.atGoal[mover], or_(load(b.atGoal[mover]), reached));
+    }
+
+    Vec cell[playerCount];
+    for (int p = 0; p < playerCount; p++) {
+        cell[p] = gather(pathCells.cells[p], load(b.pos[p]));
+    }
+
+    // Coin collections
+    for (int c = 0; c < coinCount; c++) {
+        Vec live = and_(active, load(b.coinLive[c]));
+        if (!any(live)) continue;
+        Vec coinCellV = load(b.coinCell[c]);
+        Vec gold = load(b.coinGold[c]);
+
+        for (int p = 0; p < playerCount; p++) {
+            Vec hit = and_(live, eq(cell[p], coinCellV));
+            live = andnot(hit, live);
+            Vec hitGold = and_(hit, gold);
+            Vec hitSilver = andnot(gold, hit);
+
+            store(b.goldCoins[p], sub(load(b.goldCoins[p]), hitGold));
+            store(b.silverCoins[p], sub(load(b.silverCoins[p]), hitSilver));
+            store(b.score[p], add(load(b.score[p]),
+                or_(and_(hitGold, splat(GOLD_COIN_POINTS)), and_(hitSilver, splat(SILVER_COIN_POINTS)))));
+            store(b.coinsCollected[GOLD], sub(load(b.coinsCollected[GOLD]), hitGold));
+            store(b.coinsCollected[SILVER], sub(load(b.coinsCollected[SILVER]), hitSilver));
+        }
+        store(b.coinLive[c], andnot(andnot(live, active), load(b.coinLive[c])));
+    }
+
+    // Hurdle interactions, the handleHurdle switch as one masked update per type
+    for (int h = 0; h < hurdleCount; h++) {
+        Vec live = and_(active, load(b.hurdleLive[h]));
+        if (!any(live)) continue;
+        Vec hurdleCellV = load(b.hurdleCell[h]);
+        Vec type = load(b.hurdleType[h]);
+
+        for (int p = 0; p < playerCount; p++) {
+            Vec hit = and_(live, eq(cell[p], hurdleCellV));
+            if (!any(hit)) continue;
+            live = andnot(hit, live);
+
+            Vec skip = load(b.skipTurns[p]);
+            for (int t = 0; t < hurdleTypeCount; t++) {
+                Vec mask = and_(hit, eq(type, splat(t)));
+                if (!any(mask)) continue;
+
+                // The catalog's counter item, penalty and pushback, as in PlayerState::handleHurdle
+                const HurdleRule& rule = rules().hurdles[t];
+                int32_t* item = b.items[rule.counter][p];
+                Vec count = load(item);
+                Vec blocked = and_(mask, gt(count, zero));
+                Vec missed = andnot(blocked, mask);
+                store(item, add(count, blocked));
+                skip = select(missed, splat(rule.skipTurns), skip);
+
+                if (rule.pushback > 0) {
+                    Vec pos = load(b.pos[p]);
+                    pos = select(and_(missed, gt(pos, splat(rule.pushback - 1))), sub(pos, splat(rule.pushback)), pos);
+                    store(b.pos[p], pos);
+                    cell[p] = gather(pathCells.cells[p], pos);
+                }
+
+                store(b.hurdleHits[t], sub(load(b.hurdleHits[t]), missed));
+                store(b.hurdleBlocks[t], sub(load(b.hurdleBlocks[t]), blocked));
+            }
+            store(b.skipTurns[p], skip);
+        }
+        store(b.hurdleLive[h], andnot(andnot(live, active), load(b.hurdleLive[h])));
+    }
+
+    // Check if any player reached the goal
+    Vec over = load(b.gameOver);
+    for (int p = 0; p < playerCount; p++) {
+        over = or_(over, and_(active, load(b.atGoal[p])));
+    }
+    store(b.gameOver, over);
+}
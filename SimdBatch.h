@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GameEngine.h"
+
+#include <cstdint>
+
+// Structure-of-arrays layout holding simdLanes independent games, one per
+// vector lane. stepMoves() advances every lane by one move of the same
+// player: the move, coin pickup and hurdle resolution are done with masked
+// selects instead of per-game branches. Built with AVX2 it works on eight
+// 32-bit lanes per instruction; otherwise the same kernel runs on plain
+// arrays.
+//
+// Flags (coinGold, coinLive, hurdleLive, atGoal, gameOver) are lane masks:
+// -1 for true and 0 for false.
+
+const int simdLanes = 8;
+
+struct alignas(32) SimdBatch {
+    int32_t pos[playerCount][simdLanes];
+    int32_t skipTurns[playerCount][simdLanes];
+    int32_t goldCoins[playerCount][simdLanes];
+    int32_t silverCoins[playerCount][simdLanes];
+    int32_t score[playerCount][simdLanes];
+    int32_t items[itemTypeCount][playerCount][simdLanes];
+    int32_t atGoal[playerCount][simdLanes];
+
+    int32_t coinCell[coinCount][simdLanes];     // y * gridSize + x
+    int32_t coinGold[coinCount][simdLanes];
+    int32_t coinLive[coinCount][simdLanes];
+
+    int32_t hurdleCell[hurdleCount][simdLanes];
+    int32_t hurdleType[hurdleCount][simdLanes];
+    int32_t hurdleLive[hurdleCount][simdLanes];
+
+    int32_t gameOver[simdLanes];
+
+    // Per-lane counters for batch statistics
+    int32_t turns[simdLanes];
+    int32_t hurdleHits[hurdleTypeCount][simdLanes];
+    int32_t hurdleBlocks[hurdleTypeCount][simdLanes];
+    int32_t coinsCollected[2][simdLanes];
+};
+
+// Marks every lane finished and clears the counters; lanes that are never
+// packed stay idle.
+void clearBatch(SimdBatch& batch);
+
+// Lanes hold the starting layout's coinCount coins and hurdleCount hurdles,
+// so packLane() takes boards that have not had anything added since
+// newGame(); move-only games never add anything. unpackLane() gives slots
+// back to the pools in slot order, not the order they were freed in.
+void packLane(SimdBatch& batch, int lane, const GameState& state);
+void unpackLane(const SimdBatch& batch, int lane, GameState& state);
+
+// Same as calling step(state, Action::move(player)) on every lane.
+void stepMoves(SimdBatch& batch, int player);
+
+bool allLanesOver(const SimdBatch& batch);
+
+// Name of the instruction set the kernel was compiled for
+const char* simdKernelName();
@@ -0,0 +1,183 @@
+#include "BatchRunner.h"
+#include "Catalog.h"
+#include "SimdBatch.h"
+#include "Snapshot.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Command-line batch mode: plays complete matches with scripted or random
+// policies and prints aggregate statistics.
+
+static void printUsage() {
+    std::cout << "Usage: Simulator [--games N] [--threads N] [--policy random|scripted|move-only]"
+        " [--max-turns N] [--seed N] [--rules FILE] [--simd | --bitboard] [--verify] [--alloc-check]"
+        " [--replay-check FILE] [--snapshot-check FILE] [--undo-check STEPS] [--net-check]"
+        " [--spectate-check VIEWERS]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    BatchConfig config;
+    bool verify = false;
+    bool allocCheck = false;
+    bool netCheck = false;
+    const char* replayCheckPath = nullptr;
+    const char* snapshotCheckPath = nullptr;
+    int undoCheckSteps = 0;
+    int spectateViewers = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--help") == 0) {
+            printUsage();
+            return 0;
+        }
+        if (std::strcmp(arg, "--simd") == 0) {
+            config.vectorized = true;
+            config.policy = POLICY_MOVE_ONLY;
+            continue;
+        }
+        if (std::strcmp(arg, "--bitboard") == 0) {
+            config.bitboard = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--verify") == 0) {
+            verify = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--alloc-check") == 0) {
+            allocCheck = true;
+            continue;
+        }
+        if (std::strcmp(arg, "--net-check") == 0) {
+            netCheck = true;
+            continue;
+        }
+        if (!value) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if (std::strcmp(arg, "--games") == 0) config.games = std::atoll(value);
+        else if (std::strcmp(arg, "--threads") == 0) config.threads = std::atoi(value);
+        else if (std::strcmp(arg, "--max-turns") == 0) config.maxTurns = std::atoi(value);
+        else if (std::strcmp(arg, "--seed") == 0) config.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--replay-check") == 0) replayCheckPath = value;
+        else if (std::strcmp(arg, "--snapshot-check") == 0) snapshotCheckPath = value;
+        else if (std::strcmp(arg, "--undo-check") == 0) undoCheckSteps = std::atoi(value);
+        else if (std::strcmp(arg, "--spectate-check") == 0) spectateViewers = std::atoi(value);
+        else if (std::strcmp(arg, "--rules") == 0) {
+            Catalog catalog;
+            std::string error;
+            if (!loadCatalog(value, catalog, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            setRules(catalog);
+        }
+        else if (std::strcmp(arg, "--policy") == 0) {
+            if (std::strcmp(value, "random") == 0) config.policy = POLICY_RANDOM;
+            else if (std::strcmp(value, "scripted") == 0) config.policy = POLICY_SCRIPTED;
+            else if (std::strcmp(value, "move-only") == 0) config.policy = POLICY_MOVE_ONLY;
+            else {
+                std::cerr << "Unknown policy: " << value << std::endl;
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        i++;
+    }
+
+    if (config.vectorized && config.bitboard) {
+        std::cerr << "--simd and --bitboard cannot be combined" << std::endl;
+        return 1;
+    }
+
+    if (verify && !config.vectorized) {
+        std::cout << "Checking the turn scheduler against stepping every turn on " << config.games << " games..." << std::endl;
+        if (!verifyScheduler(config)) return 1;
+    }
+    if (verify && config.bitboard) {
+        std::cout << "Checking bitboard step() against GameState on " << config.games << " games..." << std::endl;
+        if (!verifyBitboard(config)) return 1;
+        std::cout << "All states match." << std::endl;
+        return 0;
+    }
+    if (verify) {
+        std::cout << "Checking " << simdKernelName() << " kernel against step() on " << config.games << " games..." << std::endl;
+        if (!verifyVectorized(config.games, config.maxTurns, config.seed)) return 1;
+        std::cout << "All lanes match." << std::endl;
+        return 0;
+    }
+
+    if (replayCheckPath) {
+        std::cout << "Checking replays of " << config.games << " games through " << replayCheckPath << "..." << std::endl;
+        double bytesPerGame = 0;
+        if (!verifyReplays(config, replayCheckPath, bytesPerGame)) return 1;
+        std::cout << "Every turn replays exactly; " << bytesPerGame << " bytes per game before keyframes." << std::endl;
+        return 0;
+    }
+
+    if (snapshotCheckPath) {
+        std::cout << "Checking snapshots of every position in " << config.games << " games through " << snapshotCheckPath << "..." << std::endl;
+        double restoreNanos = 0;
+        if (!verifySnapshots(config, snapshotCheckPath, restoreNanos)) return 1;
+        std::cout << "Every position restores exactly; " << sizeof(Snapshot) << " bytes each, restored in "
+            << restoreNanos << " ns." << std::endl;
+        return 0;
+    }
+
+    if (undoCheckSteps > 0) {
+        std::cout << "Checking undo and redo over " << undoCheckSteps << " steps in " << config.games << " games..." << std::endl;
+        double stepNanos = 0;
+        if (!verifyUndo(config, undoCheckSteps, stepNanos)) return 1;
+        std::cout << "Every step undoes and redoes exactly; " << undoCheckSteps * sizeof(Snapshot) / 1024.0
+            << " KB of history, " << stepNanos << " ns a step." << std::endl;
+        return 0;
+    }
+
+    if (netCheck) {
+        std::cout << "Playing " << config.games << " games between a host and a remote player over loopback..." << std::endl;
+        NetCheckResult net;
+        if (!verifyNetPlay(config, net)) return 1;
+        std::cout << "Every delta matched the host's checksum over " << net.actions << " remote actions." << std::endl;
+        std::cout << "Host per action:  avg " << net.processMicros << " us, p99 " << net.processP99Micros << " us" << std::endl;
+        std::cout << "Round trip:       avg " << net.roundTripMicros << " us, p99 " << net.roundTripP99Micros << " us" << std::endl;
+        std::cout << "Host to remote:   " << net.bytesPerTurn << " bytes per turn" << std::endl;
+        return 0;
+    }
+
+    if (spectateViewers > 0) {
+        std::cout << "Playing " << config.games << " games to " << spectateViewers << " local viewers..." << std::endl;
+        SpectatorCheckResult watched;
+        if (!verifySpectators(config, spectateViewers, watched)) return 1;
+        std::cout << "Every viewer followed the match to its final position." << std::endl;
+        std::cout << "Published:        " << watched.frames << " frames, " << watched.bytesPerFrame << " bytes each" << std::endl;
+        std::cout << "Per publish:      avg " << watched.publishNanos << " ns, p99 " << watched.publishP99Nanos << " ns" << std::endl;
+        std::cout << "Fanned out:       " << watched.fanOutBytes / (1024 * 1024) << " MB to the viewers" << std::endl;
+        return 0;
+    }
+
+    if (allocCheck) {
+        std::cout << "Checking that " << config.games << " games run without heap allocations..." << std::endl;
+        if (!verifyNoAllocations(config)) return 1;
+        std::cout << "No allocations." << std::endl;
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BatchStats stats = runBatch(config);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    printStats(stats, elapsed.count());
+    return 0;
+}
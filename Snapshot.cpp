@@ -0,0 +1,198 @@
+#include "Snapshot.h"
+#include "Catalog.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Multi-byte fields are stored little-endian whatever the host; converting
+// either way is the same swap, and a no-op on little-endian hosts
+template <typename T>
+static T little(T value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    std::memcpy(&value, bytes, sizeof(T));
+#endif
+    return value;
+}
+
+void packSnapshot(const GameState& state, Snapshot& snapshot) {
+    std::memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.magic = little(snapshotMagic);
+    snapshot.version = snapshotVersion;
+    snapshot.boardSize = static_cast<uint8_t>(gridSize);
+    snapshot.playerCount = static_cast<uint8_t>(playerCount);
+    snapshot.flags = static_cast<uint8_t>((state.gameOver ? 1 : 0) | state.currentPlayer << 4);
+    snapshot.seed = little(state.seed);
+
+    for (int p = 0; p < playerCount; p++) {
+        const PlayerState& from = state.players[p];
+        SnapshotPlayer& to = snapshot.players[p];
+        to.pos = little(static_cast<uint16_t>(from.pos));
+        to.score = little(static_cast<int16_t>(from.score));
+        to.goldCoins = little(static_cast<int16_t>(from.goldCoins));
+        to.silverCoins = little(static_cast<int16_t>(from.silverCoins));
+        to.skipTurns = static_cast<uint8_t>(from.skipTurns);
+        for (int i = 0; i < itemTypeCount; i++) {
+            to.items[i] = static_cast<uint8_t>(from.items[i]);
+        }
+        to.atGoal = from.atGoal ? 1 : 0;
+    }
+
+    const SlotPool<entityCapacity>& slots = state.hurdles.slots;
+    int listed = 0;
+    for (int cell = 0; cell < Board::cellCount; cell++) {
+        if (state.cellHurdle[cell] >= 0) {
+            snapshot.hurdleSlots[listed++] = little(static_cast<SnapshotSlot>(state.cellHurdle[cell]));
+        }
+    }
+    snapshot.freeSlotCount = little(static_cast<uint16_t>(slots.freeSlotCount()));
+    for (int i = 0; i < slots.freeSlotCount(); i++) {
+        snapshot.hurdleSlots[listed++] = little(static_cast<SnapshotSlot>(slots.freeSlot(i)));
+    }
+
+    for (int cell = 0; cell < Board::cellCount; cell++) {
+        int coin = state.cellCoin[cell];
+        int hurdle = state.cellHurdle[cell];
+        int packed = 0;
+        if (coin >= 0) packed |= 1 + state.coins.type[coin];
+        if (hurdle >= 0) packed |= (1 + state.hurdles.type[hurdle]) << 2;
+        snapshot.cells[cell] = static_cast<uint8_t>(packed);
+    }
+}
+
+bool unpackSnapshot(const Snapshot& snapshot, GameState& state) {
+    if (little(snapshot.magic) != snapshotMagic || snapshot.version != snapshotVersion ||
+        snapshot.boardSize != gridSize || snapshot.playerCount != playerCount) {
+        return false;
+    }
+    int currentPlayer = snapshot.flags >> 4;
+    if (currentPlayer >= playerCount) return false;
+    for (int p = 0; p < playerCount; p++) {
+        const SnapshotPlayer& player = snapshot.players[p];
+        int pos = little(player.pos);
+        if (pos >= pathLen || player.skipTurns > maxSkipTurns || player.atGoal > 1) return false;
+        if ((player.atGoal != 0) != (Board::pathCell(p, pos) == Board::goalCell)) return false;
+        if (little(player.goldCoins) < 0 || little(player.silverCoins) < 0) return false;
+    }
+    int coins = 0, hurdles = 0;
+    for (int cell = 0; cell < Board::cellCount; cell++) {
+        int coin = snapshot.cells[cell] & 3;
+        int hurdle = snapshot.cells[cell] >> 2;
+        if (coin > 2 || hurdle > hurdleTypeCount || (coin && hurdle)) return false;
+        if ((coin || hurdle) && Board::isStartOrGoal(cell)) return false;
+        if (coin) coins++;
+        if (hurdle) hurdles++;
+    }
+    int freeSlots = little(snapshot.freeSlotCount);
+    if (coins > entityCapacity || hurdles + freeSlots > entityCapacity) return false;
+
+    // Live and free slots together must number every slot handed out once
+    int slotsUsed = hurdles + freeSlots;
+    bool seen[entityCapacity] = {};
+    for (int i = 0; i < slotsUsed; i++) {
+        int slot = little(snapshot.hurdleSlots[i]);
+        if (slot >= slotsUsed || seen[slot]) return false;
+        seen[slot] = true;
+    }
+
+    // Checked, so nothing below can fail half way
+    GameState restored;
+    for (int p = 0; p < playerCount; p++) {
+        const SnapshotPlayer& from = snapshot.players[p];
+        PlayerState& to = restored.players[p];
+        to.pos = little(from.pos);
+        to.score = little(from.score);
+        to.goldCoins = little(from.goldCoins);
+        to.silverCoins = little(from.silverCoins);
+        to.skipTurns = from.skipTurns;
+        for (int i = 0; i < itemTypeCount; i++) {
+            to.items[i] = from.items[i];
+        }
+        to.atGoal = from.atGoal != 0;
+    }
+    int hurdleCells[entityCapacity];
+    int hurdleTypes[entityCapacity];
+    for (int h = 0; h < slotsUsed; h++) {
+        hurdleCells[h] = -1;
+    }
+    int listed = 0;
+    for (int cell = 0; cell < Board::cellCount; cell++) {
+        int coin = snapshot.cells[cell] & 3;
+        int hurdle = snapshot.cells[cell] >> 2;
+        if (coin) restored.coins.add(cell, coin - 1);
+        if (hurdle) {
+            int slot = little(snapshot.hurdleSlots[listed++]);
+            hurdleCells[slot] = cell;
+            hurdleTypes[slot] = hurdle - 1;
+        }
+    }
+
+    // As fromBitboard(): hand out every slot, then free the dead ones in
+    // the saved order so the next placement picks the same slot
+    for (int h = 0; h < slotsUsed; h++) {
+        if (hurdleCells[h] >= 0) restored.hurdles.add(hurdleCells[h], hurdleTypes[h]);
+        else restored.hurdles.add(0, 0);
+    }
+    for (int i = 0; i < freeSlots; i++) {
+        restored.hurdles.remove(little(snapshot.hurdleSlots[hurdles + i]));
+    }
+
+    restored.currentPlayer = currentPlayer;
+    restored.gameOver = (snapshot.flags & 1) != 0;
+    restored.seed = little(snapshot.seed);
+    restored.rng.seed(restored.seed);
+    rebuildOccupancy(restored);
+    state = restored;
+    return true;
+}
+
+bool saveSnapshots(const char* path, const GameState* states, int count, std::string& error) {
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        error = std::string(path) + ": cannot create snapshot file";
+        return false;
+    }
+
+    Snapshot snapshot;
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        packSnapshot(states[i], snapshot);
+        ok = std::fwrite(&snapshot, sizeof(snapshot), 1, file) == 1;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        error = std::string(path) + ": cannot write snapshots";
+    }
+    return ok;
+}
+
+SnapshotArchive::SnapshotArchive() : snapshots(0) {}
+
+bool SnapshotArchive::open(const char* path, std::string& error) {
+    snapshots = 0;
+    if (!mapping.open(path, error)) return false;
+
+    if (mapping.size() < sizeof(Snapshot)) {
+        error = std::string(path) + ": not a snapshot file";
+        return false;
+    }
+    const Snapshot& first = *reinterpret_cast<const Snapshot*>(mapping.data());
+    if (little(first.magic) != snapshotMagic) {
+        error = std::string(path) + ": not a snapshot file";
+        return false;
+    }
+    if (first.version != snapshotVersion) {
+        error = std::string(path) + ": snapshot version " + std::to_string(first.version) + " is not supported";
+        return false;
+    }
+    if (first.boardSize != gridSize || first.playerCount != playerCount || mapping.size() % sizeof(Snapshot) != 0) {
+        error = std::string(path) + ": saved on a " + std::to_string(first.boardSize) + "x" + std::to_string(first.boardSize) +
+            " board for " + std::to_string(first.playerCount) + " players by a different build";
+        return false;
+    }
+    snapshots = static_cast<int>(mapping.size() / sizeof(Snapshot));
+    return true;
+}
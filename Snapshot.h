@@ -0,0 +1,126 @@
+#pragma once
+
+#include "GameEngine.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Saved positions. A Snapshot packs a whole match into one fixed-layout
+// record (96 bytes for two players on 5x5) that is read in place: a
+// snapshot file is nothing but records back to back, mapped and indexed
+// directly, so restoring one from an archive of thousands costs a bounds
+// check and a few loops over the board.
+//
+// Layout, little-endian on every host (packSnapshot() converts), no
+// padding between fields:
+//
+//     offset  size  field
+//          0     4  magic "AQSN"
+//          4     1  version (1)
+//          5     1  board size N
+//          6     1  player count P
+//          7     1  flags: bit 0 game over, bits 4-7 player who moved last
+//          8     8  board seed
+//         16  14*P  players, each:
+//                      0  u16 step along the player's path
+//                      2  i16 score
+//                      4  i16 gold coins
+//                      6  i16 silver coins
+//                      8  u8  turns left to sit out
+//                      9  u8  swords, shields, water, keys (4 bytes)
+//                     13  u8  1 once on the goal
+//   16+14*P     2  number of free hurdle slots F
+//   18+14*P   S*E  hurdle slots, S bytes each (1 while entityCapacity E
+//                  fits in a byte, else 2): the slot of every hurdle on
+//                  the board in cell order, then the F free slots oldest
+//                  first, then zeros
+//         C   N*N  one byte per cell (C = 18+14*P+S*E), row-major from
+//                  the top left:
+//                      bits 0-1  0 no coin, 1 gold, 2 silver
+//                      bits 2-4  0 no hurdle, 1 fire, 2 snake, 3 ghost,
+//                                4 lion, 5 lock
+//                   zero padding up to a multiple of 8 bytes
+//
+// The generator only lays out the board, so it is not stored: a restored
+// state has it reseeded from the board seed. Hurdle slots are kept because
+// a move that lands on several hurdles meets them in slot order; coin
+// slots are renumbered in cell order, which never changes how play
+// continues.
+
+const uint32_t snapshotMagic = 0x4E535141;  // "AQSN"
+const uint8_t snapshotVersion = 1;
+
+static_assert(gridSize <= 255 && playerCount <= 16, "the snapshot header has one byte for each");
+static_assert(itemTypeCount == 4, "the snapshot layout has four inventory slots");
+static_assert(pathLen <= 65535 && Board::cellCount <= 65536, "path steps are stored in 16 bits");
+
+#pragma pack(push, 1)
+struct SnapshotPlayer {
+    uint16_t pos;
+    int16_t score;
+    int16_t goldCoins, silverCoins;
+    uint8_t skipTurns;
+    uint8_t items[itemTypeCount];
+    uint8_t atGoal;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SnapshotPlayer) == 14, "players are 14 bytes on disk");
+
+typedef std::conditional<entityCapacity <= 255, uint8_t, uint16_t>::type SnapshotSlot;
+
+struct Snapshot {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t boardSize;
+    uint8_t playerCount;
+    uint8_t flags;
+    uint64_t seed;
+    SnapshotPlayer players[::playerCount];
+    uint16_t freeSlotCount;
+    SnapshotSlot hurdleSlots[entityCapacity];
+    uint8_t cells[Board::cellCount];
+};
+
+const int snapshotDataSize = 18 + 14 * playerCount + static_cast<int>(sizeof(SnapshotSlot)) * entityCapacity + Board::cellCount;
+
+static_assert(sizeof(Snapshot) % 8 == 0 && sizeof(Snapshot) < snapshotDataSize + 8,
+    "Snapshot must have the documented layout");
+static_assert(gridSize != 5 || playerCount != 2 || sizeof(Snapshot) == 96,
+    "the size quoted above has changed");
+
+void packSnapshot(const GameState& state, Snapshot& snapshot);
+
+// Fails, leaving `state` untouched, if the snapshot is from another board
+// size, player count or format version, or holds values no game can reach:
+// a position off the path, a goal flag that disagrees with it, negative
+// coins, a penalty longer than maxSkipTurns, a bad cell or a slot list
+// that is not a permutation. Any item count fits, since items are bought
+// without limit.
+bool unpackSnapshot(const Snapshot& snapshot, GameState& state);
+
+// Writes `count` states to `path` as one archive
+bool saveSnapshots(const char* path, const GameState* states, int count, std::string& error);
+
+// A snapshot file mapped read-only; at() points into the mapping
+class SnapshotArchive {
+public:
+    SnapshotArchive();
+
+    // Fails if the file is not a whole number of snapshots for this build
+    bool open(const char* path, std::string& error);
+
+    int count() const {
+        return snapshots;
+    }
+
+    const Snapshot& at(int index) const {
+        return reinterpret_cast<const Snapshot*>(mapping.data())[index];
+    }
+
+private:
+    MappedFile mapping;
+    int snapshots;
+};
@@ -0,0 +1,253 @@
+#include "Socket.h"
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+typedef int socklen_t;
+const intptr_t invalidSocket = static_cast<intptr_t>(INVALID_SOCKET);
+const int sendFlags = 0;
+
+static bool wouldBlock() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+static void closeSocket(intptr_t fd) {
+    closesocket(static_cast<SOCKET>(fd));
+}
+
+static int pollSocket(intptr_t fd, short events, int milliseconds) {
+    WSAPOLLFD entry = { static_cast<SOCKET>(fd), events, 0 };
+    return WSAPoll(&entry, 1, milliseconds);
+}
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+const intptr_t invalidSocket = -1;
+const int sendFlags = MSG_NOSIGNAL;     // a closed peer is an error, not SIGPIPE
+
+static bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static void closeSocket(intptr_t fd) {
+    ::close(static_cast<int>(fd));
+}
+
+static int pollSocket(intptr_t fd, short events, int milliseconds) {
+    pollfd entry = { static_cast<int>(fd), events, 0 };
+    return poll(&entry, 1, milliseconds);
+}
+#endif
+
+static void setNoDelay(intptr_t fd) {
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&on), sizeof(on));
+}
+
+Socket::Socket() : fd(invalidSocket) {}
+
+Socket::Socket(intptr_t descriptor) : fd(descriptor) {}
+
+Socket::~Socket() {
+    close();
+}
+
+Socket::Socket(Socket&& other) : fd(other.fd) {
+    other.fd = invalidSocket;
+}
+
+Socket& Socket::operator=(Socket&& other) {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        other.fd = invalidSocket;
+    }
+    return *this;
+}
+
+bool Socket::startup() {
+#if defined(_WIN32)
+    static bool started = false;
+    WSADATA data;
+    if (!started) started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    return started;
+#else
+    return true;
+#endif
+}
+
+int Socket::raiseOpenLimit() {
+#if defined(_WIN32)
+    return 0;
+#else
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur == RLIM_INFINITY) return 0;
+    return limit.rlim_cur > 1 << 30 ? 1 << 30 : static_cast<int>(limit.rlim_cur);
+#endif
+}
+
+bool Socket::listen(uint16_t port, std::string& error, bool shared) {
+    close();
+    fd = static_cast<intptr_t>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if (fd == invalidSocket) {
+        error = "cannot create a socket";
+        return false;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+#if defined(SO_REUSEPORT)
+    if (shared) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&on), sizeof(on));
+#else
+    (void)shared;
+#endif
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        close();
+        error = "cannot listen on port " + std::to_string(port);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::connect(const char* host, uint16_t port, std::string& error) {
+    close();
+    char service[8];
+    std::snprintf(service, sizeof(service), "%u", static_cast<unsigned>(port));
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host, service, &hints, &found) != 0 || !found) {
+        error = std::string(host) + ": unknown host";
+        return false;
+    }
+
+    fd = static_cast<intptr_t>(::socket(found->ai_family, found->ai_socktype, found->ai_protocol));
+    bool ok = fd != invalidSocket && ::connect(fd, found->ai_addr, static_cast<socklen_t>(found->ai_addrlen)) == 0;
+    freeaddrinfo(found);
+    if (!ok) {
+        close();
+        error = std::string(host) + ":" + service + ": cannot connect";
+        return false;
+    }
+    setNoDelay(fd);
+    return true;
+}
+
+bool Socket::accept(Socket& client) {
+    intptr_t accepted = static_cast<intptr_t>(::accept(fd, nullptr, nullptr));
+    if (accepted == invalidSocket) return false;
+    setNoDelay(accepted);
+    client = Socket(accepted);
+    return true;
+}
+
+void Socket::setNonBlocking() {
+#if defined(_WIN32)
+    u_long on = 1;
+    ioctlsocket(static_cast<SOCKET>(fd), FIONBIO, &on);
+#else
+    fcntl(static_cast<int>(fd), F_SETFL, fcntl(static_cast<int>(fd), F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+void Socket::close() {
+    if (fd != invalidSocket) {
+        closeSocket(fd);
+    }
+    fd = invalidSocket;
+}
+
+bool Socket::isOpen() const {
+    return fd != invalidSocket;
+}
+
+uint16_t Socket::port() const {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return 0;
+    return ntohs(address.sin_port);
+}
+
+int Socket::send(const void* data, int size) {
+    int sent = static_cast<int>(::send(fd, static_cast<const char*>(data), size, sendFlags));
+    if (sent >= 0) return sent;
+    return wouldBlock() ? 0 : -1;
+}
+
+int Socket::sendv(const SocketSlice* slices, int count) {
+    if (count > maxSlices) count = maxSlices;
+#if defined(_WIN32)
+    WSABUF parts[maxSlices];
+    for (int i = 0; i < count; i++) {
+        parts[i].buf = static_cast<char*>(const_cast<void*>(slices[i].data));
+        parts[i].len = static_cast<ULONG>(slices[i].size);
+    }
+    DWORD sent = 0;
+    if (WSASend(static_cast<SOCKET>(fd), parts, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) == 0) {
+        return static_cast<int>(sent);
+    }
+#else
+    iovec parts[maxSlices];
+    for (int i = 0; i < count; i++) {
+        parts[i].iov_base = const_cast<void*>(slices[i].data);
+        parts[i].iov_len = static_cast<size_t>(slices[i].size);
+    }
+    // sendmsg rather than writev, which cannot turn off SIGPIPE
+    msghdr message = {};
+    message.msg_iov = parts;
+    message.msg_iovlen = count;
+    int sent = static_cast<int>(::sendmsg(static_cast<int>(fd), &message, sendFlags));
+    if (sent >= 0) return sent;
+#endif
+    return wouldBlock() ? 0 : -1;
+}
+
+bool Socket::sendAll(const void* data, int size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        int sent = send(bytes, size);
+        if (sent < 0 || (sent == 0 && !waitWritable(-1))) return false;
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+int Socket::receive(void* data, int size) {
+    int got = static_cast<int>(::recv(fd, static_cast<char*>(data), size, 0));
+    if (got > 0) return got;
+    if (got < 0 && wouldBlock()) return 0;
+    return -1;
+}
+
+bool Socket::waitReadable(int milliseconds) const {
+    return pollSocket(fd, POLLIN, milliseconds) > 0;
+}
+
+bool Socket::waitWritable(int milliseconds) const {
+    return pollSocket(fd, POLLOUT, milliseconds) > 0;
+}
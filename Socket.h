@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// One piece of a gathered send (Socket::sendv)
+struct SocketSlice {
+    const void* data;
+    int size;
+};
+
+// A TCP socket, over BSD sockets or Winsock. Only what network play needs:
+// listening, connecting and moving bytes, with Nagle's delay turned off so
+// each small message leaves as soon as it is sent.
+class Socket {
+public:
+    Socket();
+    ~Socket();
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    Socket(Socket&& other);
+    Socket& operator=(Socket&& other);
+
+    // Winsock has to be started once per process; elsewhere a no-op
+    static bool startup();
+
+    // Lifts the per-process limit on open sockets as far as the system
+    // allows and returns it (0 where there is no such limit)
+    static int raiseOpenLimit();
+
+    // Listens on every interface; port 0 picks a free one (see port()).
+    // With `shared`, other sockets may listen on the same port and the
+    // system spreads new connections between them (SO_REUSEPORT, where
+    // there is one).
+    bool listen(uint16_t port, std::string& error, bool shared = false);
+    bool connect(const char* host, uint16_t port, std::string& error);
+
+    // Takes the next waiting connection into `client`. Returns false if
+    // there is none, without waiting when the socket is non-blocking.
+    bool accept(Socket& client);
+
+    void setNonBlocking();
+    void close();
+
+    bool isOpen() const;
+    uint16_t port() const;
+
+    // Bytes written, 0 if the socket is full, -1 once it has failed
+    int send(const void* data, int size);
+
+    // Sends up to maxSlices pieces, in order, with one call and no copy
+    // (sendmsg or WSASend); as send()
+    static const int maxSlices = 64;
+    int sendv(const SocketSlice* slices, int count);
+
+    // Sends everything, waiting whenever the socket is full
+    bool sendAll(const void* data, int size);
+
+    // Bytes read, 0 if nothing has arrived, -1 once the peer has closed
+    // the connection or it failed
+    int receive(void* data, int size);
+
+    // Waits up to `milliseconds` for something to read; false on timeout
+    bool waitReadable(int milliseconds) const;
+
+    // Waits up to `milliseconds` (-1 = as long as it takes) for room to
+    // send; false on timeout
+    bool waitWritable(int milliseconds) const;
+
+    // The descriptor, for event loops that watch many sockets
+    intptr_t handle() const {
+        return fd;
+    }
+
+private:
+    intptr_t fd;
+
+    explicit Socket(intptr_t descriptor);
+};
@@ -0,0 +1,234 @@
+#include "Spectator.h"
+
+#include <chrono>
+#include <cstring>
+
+// How often the sender looks for new viewers, viewer requests and
+// viewers whose sockets were full, when nothing is published meanwhile
+const int feedTickMillis = 10;
+
+struct SpectatorFeed::Viewer {
+    Socket socket;
+    NetReader reader;
+    bool greeted;                                   // the greeting is out
+    std::shared_ptr<const SpectatorFrame> keyframe; // goes out before the chain, or null
+    std::shared_ptr<SpectatorFrame> last;           // last chain frame sent, or covered by the keyframe
+    int offset;                                     // bytes of the first unsent frame already written
+    bool wantsKeyframe;
+};
+
+SpectatorFeed::SpectatorFeed() : viewerLimit(defaultMaxViewers), viewerCount(0), sentBytes(0), started(false), frameCount(0), frameBytes(0),
+    stopping(false), sequence(0) {
+    std::memset(static_cast<void*>(&published), 0, sizeof(published));
+    std::memset(static_cast<void*>(&latest), 0, sizeof(latest));
+}
+
+SpectatorFeed::~SpectatorFeed() {
+    close();
+}
+
+bool SpectatorFeed::open(uint16_t port, std::string& error, int maxViewers) {
+    close();
+    if (!Socket::startup() || !listener.listen(port, error)) {
+        if (error.empty()) error = "networking is not available";
+        return false;
+    }
+    listener.setNonBlocking();
+    viewerLimit = maxViewers;
+    started = false;
+    stopping = false;
+    tail = std::make_shared<SpectatorFrame>();
+    tail->number = 0;
+    tail->size = 0;
+    sender = std::thread([this]() { serve(); });
+    return true;
+}
+
+void SpectatorFeed::close() {
+    if (sender.joinable()) {
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        sender.join();
+    }
+    listener.close();
+    tail.reset();
+}
+
+void SpectatorFeed::publish(const GameState& state) {
+    if (!sender.joinable()) return;
+    Snapshot now;
+    packSnapshot(state, now);
+    if (started && std::memcmp(&now, &published, sizeof(now)) == 0) return;
+
+    // The one copy every viewer is sent from
+    std::shared_ptr<SpectatorFrame> frame = std::make_shared<SpectatorFrame>();
+    uint16_t next = static_cast<uint16_t>(sequence + 1);
+    const int deltaAt = netHeaderSize + 4;
+    int length = started ? encodeDelta(published, now, frame->bytes + deltaAt, netMaxMessage - deltaAt) : -1;
+    if (length < 0) {
+        std::memcpy(frame->bytes + netHeaderSize, &now, sizeof(now));
+        frame->size = writeHeader(frame->bytes, NET_KEYFRAME, next, sizeof(now));
+    }
+    else {
+        putU32(frame->bytes + netHeaderSize, snapshotChecksum(now));
+        frame->size = writeHeader(frame->bytes, NET_DELTA, next, 4 + length);
+    }
+    published = now;
+    started = true;
+    frameCount++;
+    frameBytes += frame->size;
+
+    {
+        std::lock_guard<std::mutex> hold(lock);
+        frame->number = tail->number + 1;
+        tail->next = frame;
+        tail = std::move(frame);
+        latest = now;
+        sequence = next;
+    }
+    wake.notify_one();
+}
+
+// Answers a viewer's keyframe request; false once it has hung up or sent
+// anything else
+static bool readViewer(Socket& socket, NetReader& reader, bool& wantsKeyframe) {
+    if (!reader.fill(socket)) return false;
+    int size = 0;
+    while (const uint8_t* in = reader.next(size)) {
+        if (in[2] != NET_RESYNC) return false;
+        wantsKeyframe = true;
+    }
+    return !reader.broken();
+}
+
+void SpectatorFeed::serve() {
+    std::vector<std::unique_ptr<Viewer>> viewers;
+    SpectatorFrame hello;
+    hello.size = writeHello(hello.bytes, netSpectatorSeat);
+
+    // Late joiners and viewers starting over share one keyframe per
+    // position. Chain positions are kept as numbers, not frames, so the
+    // sender alone never holds old frames alive.
+    std::shared_ptr<const SpectatorFrame> keyframe;
+    uint64_t keyframeNumber = 0;
+    uint64_t seen = 0;
+    auto lastRead = std::chrono::steady_clock::now();
+
+    while (true) {
+        std::shared_ptr<SpectatorFrame> end;
+        Snapshot state;
+        uint16_t stateSequence;
+        {
+            std::unique_lock<std::mutex> hold(lock);
+            wake.wait_for(hold, std::chrono::milliseconds(feedTickMillis), [&]() { return stopping || tail->number != seen; });
+            if (stopping) break;
+            end = tail;
+            state = latest;
+            stateSequence = sequence;
+        }
+        seen = end->number;
+        if (end->number == 0) continue;     // nothing to show yet
+
+        auto currentKeyframe = [&]() {
+            if (!keyframe || keyframeNumber != end->number) {
+                std::shared_ptr<SpectatorFrame> frame = std::make_shared<SpectatorFrame>();
+                std::memcpy(frame->bytes + netHeaderSize, &state, sizeof(state));
+                frame->size = writeHeader(frame->bytes, NET_KEYFRAME, stateSequence, sizeof(state));
+                keyframe = frame;
+                keyframeNumber = end->number;
+            }
+            return keyframe;
+        };
+
+        Socket peer;
+        while (listener.accept(peer)) {
+            if (static_cast<int>(viewers.size()) >= viewerLimit) {
+                peer.close();
+                continue;
+            }
+            std::unique_ptr<Viewer> viewer(new Viewer());
+            viewer->socket = std::move(peer);
+            viewer->socket.setNonBlocking();
+            viewer->greeted = false;
+            viewer->keyframe = currentKeyframe();
+            viewer->last = end;
+            viewer->offset = 0;
+            viewer->wantsKeyframe = false;
+            viewers.push_back(std::move(viewer));
+        }
+
+        // Viewers rarely say anything, so they are only listened to once a tick
+        auto now = std::chrono::steady_clock::now();
+        bool readTick = now - lastRead >= std::chrono::milliseconds(feedTickMillis);
+        if (readTick) lastRead = now;
+
+        for (size_t i = 0; i < viewers.size();) {
+            Viewer& viewer = *viewers[i];
+            bool keep = !readTick || readViewer(viewer.socket, viewer.reader, viewer.wantsKeyframe);
+
+            // Far behind, a viewer starts over from a keyframe at the next
+            // frame boundary; stuck inside a frame, it is dropped
+            uint64_t behind = end->number - viewer.last->number;
+            if (keep && (viewer.wantsKeyframe || behind > maxBacklog)) {
+                if (viewer.offset == 0) {
+                    viewer.keyframe = currentKeyframe();
+                    viewer.last = end;
+                    viewer.wantsKeyframe = false;
+                }
+                else if (behind > maxBacklog) {
+                    keep = false;
+                }
+            }
+
+            // Gather the greeting, keyframe and chain frames still owed and
+            // write as many as the socket takes
+            while (keep) {
+                SocketSlice slices[Socket::maxSlices];
+                int count = 0;
+                if (!viewer.greeted) slices[count++] = { hello.bytes, hello.size };
+                if (viewer.keyframe) slices[count++] = { viewer.keyframe->bytes, viewer.keyframe->size };
+                for (const SpectatorFrame* frame = viewer.last.get(); frame != end.get() && count < Socket::maxSlices;) {
+                    frame = frame->next.get();
+                    slices[count++] = { frame->bytes, frame->size };
+                }
+                if (count == 0) break;
+                slices[0].data = static_cast<const uint8_t*>(slices[0].data) + viewer.offset;
+                slices[0].size -= viewer.offset;
+
+                int sent = viewer.socket.sendv(slices, count);
+                if (sent < 0) {
+                    keep = false;
+                    break;
+                }
+                sentBytes += sent;
+
+                int left = sent;
+                int done = 0;
+                while (done < count && left >= slices[done].size) {
+                    left -= slices[done++].size;
+                    viewer.offset = 0;
+                    if (!viewer.greeted) viewer.greeted = true;
+                    else if (viewer.keyframe) viewer.keyframe.reset();
+                    else viewer.last = viewer.last->next;
+                }
+                if (done < count) {
+                    viewer.offset += left;
+                    break;      // the socket is full
+                }
+            }
+
+            if (!keep) {
+                viewers[i] = std::move(viewers.back());
+                viewers.pop_back();
+                continue;
+            }
+            i++;
+        }
+        viewerCount = static_cast<int>(viewers.size());
+    }
+    viewers.clear();
+    viewerCount = 0;
+}
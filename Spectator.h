@@ -0,0 +1,101 @@
+#pragma once
+
+#include "NetPlay.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One message as it goes out to every viewer. Frames published one after
+// another are chained, each holding the next, so a viewer keeps alive
+// exactly the frames it has still to send and the oldest ones go once
+// every viewer is past them.
+struct SpectatorFrame {
+    std::shared_ptr<SpectatorFrame> next;   // set once, when the next frame is published
+    uint64_t number;                        // position in the chain
+    int size;
+    uint8_t bytes[netMaxMessage];
+};
+
+// Broadcasts a match to viewers over the network play protocol
+// (NetProtocol.h): a viewer that joins gets a greeting as
+// netSpectatorSeat and a keyframe, then the live deltas, and can ask for
+// a keyframe again. --join on the window watches through it.
+//
+// publish() serializes a change once, into one shared frame. A sender
+// thread of its own takes in viewers and hands each one the same frames
+// through gathered writes (Socket::sendv), so the match's loop never
+// waits on a viewer and costs the same however many watch. A viewer that
+// falls more than maxBacklog frames behind skips ahead to a keyframe.
+class SpectatorFeed {
+public:
+    static const int defaultMaxViewers = 1024;
+    static const int maxBacklog = 256;
+
+    SpectatorFeed();
+    ~SpectatorFeed();
+
+    SpectatorFeed(const SpectatorFeed&) = delete;
+    SpectatorFeed& operator=(const SpectatorFeed&) = delete;
+
+    // Listens on `port` (0 picks a free one) and starts the sender thread.
+    // Viewers are let in once something has been published.
+    bool open(uint16_t port, std::string& error, int maxViewers = defaultMaxViewers);
+
+    // Hangs up on every viewer and stops the sender thread
+    void close();
+
+    uint16_t port() const {
+        return listener.port();
+    }
+
+    // Shares whatever changed since the last publish(); from the match's
+    // thread only
+    void publish(const GameState& state);
+
+    int viewers() const {
+        return viewerCount;
+    }
+
+    // Frames that changed something, and their bytes counted once each
+    long long framesPublished() const {
+        return frameCount;
+    }
+
+    long long bytesPublished() const {
+        return frameBytes;
+    }
+
+    // Every byte written to every viewer
+    long long bytesSent() const {
+        return sentBytes;
+    }
+
+private:
+    struct Viewer;
+
+    Socket listener;
+    std::thread sender;
+    int viewerLimit;
+    std::atomic<int> viewerCount;
+    std::atomic<long long> sentBytes;
+
+    // The publisher's side
+    Snapshot published;
+    bool started;
+    long long frameCount;
+    long long frameBytes;
+
+    // Shared with the sender thread
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    std::shared_ptr<SpectatorFrame> tail;  // last frame published
+    Snapshot latest;                        // the state after it
+    uint16_t sequence;                      // and its delta sequence
+
+    void serve();
+};
@@ -0,0 +1,114 @@
+#include "SpriteAtlas.h"
+
+#include <string>
+
+namespace {
+
+struct TokenStyle {
+    float radius;
+    sf::Color fill;
+    sf::String label;
+    unsigned characterSize;
+    sf::Color labelColor;
+    sf::Vector2f labelOffset;   // from the circle's top-left corner
+};
+
+// Colours, letters and offsets the board has always used for each token
+TokenStyle tokenStyle(SpriteId id) {
+    const sf::Vector2f small(11, 5);
+    switch (id) {
+    case SPRITE_GOLD_COIN: return { 20, sf::Color(255, 215, 0), "$", 22, sf::Color(150, 150, 0), small };
+    case SPRITE_SILVER_COIN: return { 20, sf::Color(192, 192, 192), sf::String(static_cast<sf::Uint32>(0xA2)), 22, sf::Color(100, 100, 100), small };
+    case SPRITE_FIRE: return { 20, sf::Color(255, 80, 80), "F", 22, sf::Color(255, 255, 150), small };
+    case SPRITE_SNAKE: return { 20, sf::Color(100, 180, 100), "S", 22, sf::Color(50, 100, 50), small };
+    case SPRITE_GHOST: return { 20, sf::Color(200, 200, 255), "G", 22, sf::Color(100, 100, 200), small };
+    case SPRITE_LION: return { 20, sf::Color(255, 180, 100), "L", 22, sf::Color(200, 100, 0), small };
+    case SPRITE_LOCK: return { 20, sf::Color(200, 100, 200), "X", 22, sf::Color(150, 0, 150), small };
+    default: break;
+    }
+    // Skip counters are bare white digits
+    static const char* const digits[] = { "1", "2", "3", "4", "5" };
+    return { 0, sf::Color::Transparent, digits[id - SPRITE_SKIP1], 16, sf::Color::White, sf::Vector2f(0, 0) };
+}
+
+}
+
+void SpriteAtlas::build(const sf::Font& font, const sf::Color* playerColors) {
+    target.create(atlasTileSize * spriteCount, atlasTileSize);
+    target.clear(sf::Color::Transparent);
+
+    for (int i = 0; i < spriteCount; i++) {
+        SpriteId id = static_cast<SpriteId>(i);
+        TokenStyle style;
+        if (id >= SPRITE_PLAYER1 && id < SPRITE_SKIP1) {
+            int player = id - SPRITE_PLAYER1;
+            style = { 33, playerColors[player], "P" + std::to_string(player + 1),
+                20, sf::Color::White, sf::Vector2f(7, 7) };
+        }
+        else {
+            style = tokenStyle(id);
+        }
+
+        float left = static_cast<float>(i * atlasTileSize);
+        if (style.radius > 0) {
+            sf::CircleShape circle(style.radius);
+            circle.setFillColor(style.fill);
+            circle.setPosition(left, 0);
+            target.draw(circle);
+        }
+
+        sf::Text label(style.label, font, style.characterSize);
+        label.setFillColor(style.labelColor);
+        label.setPosition(left + style.labelOffset.x, style.labelOffset.y);
+        target.draw(label);
+    }
+
+    target.display();
+}
+
+sf::FloatRect SpriteAtlas::textureRect(SpriteId id) const {
+    return sf::FloatRect(static_cast<float>(id * atlasTileSize), 0, atlasTileSize, atlasTileSize);
+}
+
+SpriteBatch::SpriteBatch(const SpriteAtlas& source) : atlas(source), vertices(sf::Triangles) {}
+
+void SpriteBatch::resize(int slotCount) {
+    vertices.resize(slotCount * 6);
+    slots.assign(slotCount, Slot{ -1, sf::Vector2f() });
+    for (int i = 0; i < slotCount * 6; i++) {
+        vertices[i] = sf::Vertex(sf::Vector2f(), sf::Color::Transparent);
+    }
+}
+
+void SpriteBatch::show(int slot, SpriteId id, sf::Vector2f position) {
+    Slot& s = slots[slot];
+    if (s.sprite == id && s.position == position) return;
+    s.sprite = id;
+    s.position = position;
+
+    sf::FloatRect uv = atlas.textureRect(id);
+    const float size = atlasTileSize;
+    const sf::Vector2f corners[6] = { {0, 0}, {size, 0}, {size, size}, {0, 0}, {size, size}, {0, size} };
+    for (int i = 0; i < 6; i++) {
+        sf::Vertex& v = vertices[slot * 6 + i];
+        v.position = position + corners[i];
+        v.texCoords = sf::Vector2f(uv.left, uv.top) + corners[i];
+        v.color = sf::Color::White;
+    }
+}
+
+void SpriteBatch::hide(int slot) {
+    Slot& s = slots[slot];
+    if (s.sprite < 0) return;
+    s.sprite = -1;
+
+    // Collapse the quad so it rasterises nothing
+    for (int i = 0; i < 6; i++) {
+        vertices[slot * 6 + i].position = s.position;
+    }
+}
+
+void SpriteBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    states.texture = &atlas.texture();
+    target.draw(vertices, states);
+}
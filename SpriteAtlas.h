@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Board.h"
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// Every board token drawn by the window: coins, the five hurdle types, the
+// player tokens and the skip-turn counters shown next to a player.
+enum SpriteId {
+    SPRITE_GOLD_COIN,
+    SPRITE_SILVER_COIN,
+    SPRITE_FIRE,
+    SPRITE_SNAKE,
+    SPRITE_GHOST,
+    SPRITE_LION,
+    SPRITE_LOCK,
+    SPRITE_PLAYER1,     // SPRITE_PLAYER1 + p is player p's token
+    SPRITE_SKIP1 = SPRITE_PLAYER1 + Board::playerCount,     // SPRITE_SKIP1 + n - 1 shows the number n
+    SPRITE_SKIP2,
+    SPRITE_SKIP3,
+    SPRITE_SKIP4,
+    SPRITE_SKIP5,
+    spriteCount
+};
+
+const int atlasTileSize = 68;
+
+// All tokens pre-rendered once into a single texture
+class SpriteAtlas {
+public:
+    // playerColors holds one colour per player token
+    void build(const sf::Font& font, const sf::Color* playerColors);
+
+    const sf::Texture& texture() const {
+        return target.getTexture();
+    }
+
+    sf::FloatRect textureRect(SpriteId id) const;
+
+private:
+    sf::RenderTexture target;
+};
+
+// A fixed set of sprite slots kept in one vertex array and drawn with a
+// single call. A slot only rewrites its vertices when its sprite or
+// position actually changes.
+class SpriteBatch : public sf::Drawable {
+public:
+    explicit SpriteBatch(const SpriteAtlas& source);
+
+    void resize(int slotCount);
+    void show(int slot, SpriteId id, sf::Vector2f position);
+    void hide(int slot);
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    struct Slot {
+        int sprite;     // -1 when hidden
+        sf::Vector2f position;
+    };
+
+    const SpriteAtlas& atlas;
+    sf::VertexArray vertices;
+    std::vector<Slot> slots;
+};
@@ -0,0 +1,181 @@
+#include "TextBatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int glyphsPerFace = GlyphAtlas::lastChar - GlyphAtlas::firstChar + 1;
+const unsigned atlasWidth = 512;
+const int glyphPadding = 1;     // same padding sf::Text leaves around each glyph
+
+char printable(char c) {
+    return (c < GlyphAtlas::firstChar || c > GlyphAtlas::lastChar) ? '?' : c;
+}
+
+}
+
+void GlyphAtlas::build(const sf::Font& source, const FontFace* faceList, int faceCount) {
+    font = &source;
+    faces.assign(faceList, faceList + faceCount);
+    glyphs.assign(faces.size() * glyphsPerFace, Glyph());
+
+    // Load every glyph first: the font's page textures may grow while
+    // glyphs are added, so nothing is copied until all are present.
+    std::vector<sf::IntRect> sourceRects(glyphs.size());
+    unsigned x = 0, y = 0, rowHeight = 0;
+    for (int f = 0; f < faceCount; f++) {
+        for (int c = firstChar; c <= lastChar; c++) {
+            const sf::Glyph& g = source.getGlyph(c, faces[f].characterSize, faces[f].bold);
+            int index = f * glyphsPerFace + (c - firstChar);
+
+            sf::IntRect rect(g.textureRect.left - glyphPadding, g.textureRect.top - glyphPadding,
+                g.textureRect.width + glyphPadding * 2, g.textureRect.height + glyphPadding * 2);
+            if (x + rect.width > atlasWidth) {
+                x = 0;
+                y += rowHeight;
+                rowHeight = 0;
+            }
+
+            Glyph& out = glyphs[index];
+            out.advance = g.advance;
+            out.quad = sf::FloatRect(g.bounds.left - glyphPadding, g.bounds.top - glyphPadding,
+                g.bounds.width + glyphPadding * 2, g.bounds.height + glyphPadding * 2);
+            out.uv = sf::FloatRect(static_cast<float>(x), static_cast<float>(y),
+                static_cast<float>(rect.width), static_cast<float>(rect.height));
+            sourceRects[index] = rect;
+
+            x += rect.width;
+            rowHeight = std::max(rowHeight, static_cast<unsigned>(rect.height));
+        }
+    }
+
+    target.create(atlasWidth, y + rowHeight);
+    target.clear(sf::Color::Transparent);
+    for (int f = 0; f < faceCount; f++) {
+        sf::Sprite sprite(source.getTexture(faces[f].characterSize));
+        for (int c = 0; c < glyphsPerFace; c++) {
+            int index = f * glyphsPerFace + c;
+            sprite.setTextureRect(sourceRects[index]);
+            sprite.setPosition(glyphs[index].uv.left, glyphs[index].uv.top);
+            target.draw(sprite, sf::RenderStates(sf::BlendNone));
+        }
+    }
+    target.display();
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyph(int face, char c) const {
+    return glyphs[face * glyphsPerFace + (printable(c) - firstChar)];
+}
+
+float GlyphAtlas::kerning(int face, char first, char second) const {
+    return font->getKerning(printable(first), printable(second), faces[face].characterSize);
+}
+
+TextBatch::TextBatch(const GlyphAtlas& source) : atlas(source), vertices(sf::Triangles) {}
+
+int TextBatch::addBlock(int face, sf::Color color, sf::Vector2f position, int capacity, Align align) {
+    Block block;
+    block.face = face;
+    block.color = color;
+    block.position = position;
+    block.align = align;
+    block.firstVertex = static_cast<int>(vertices.getVertexCount());
+    block.capacity = capacity;
+    block.visible = true;
+    block.text.assign(capacity + 1, '\0');
+
+    vertices.resize(vertices.getVertexCount() + capacity * 6);
+    blocks.push_back(block);
+    layout(blocks.back());
+    return static_cast<int>(blocks.size()) - 1;
+}
+
+void TextBatch::setText(int index, const char* text) {
+    Block& block = blocks[index];
+    size_t length = std::min(std::strlen(text), static_cast<size_t>(block.capacity));
+    if (std::strncmp(block.text.data(), text, length) == 0 && block.text[length] == '\0') return;
+
+    std::memcpy(block.text.data(), text, length);
+    block.text[length] = '\0';
+    layout(block);
+}
+
+void TextBatch::setColor(int index, sf::Color color) {
+    Block& block = blocks[index];
+    if (block.color == color) return;
+    block.color = color;
+    layout(block);
+}
+
+void TextBatch::setVisible(int index, bool visible) {
+    Block& block = blocks[index];
+    if (block.visible == visible) return;
+    block.visible = visible;
+    layout(block);
+}
+
+void TextBatch::layout(Block& block) {
+    sf::Vertex* out = &vertices[block.firstVertex];
+    const FontFace& face = atlas.face(block.face);
+
+    // Pen starts on the baseline, as in sf::Text
+    float penX = 0;
+    float penY = static_cast<float>(face.characterSize);
+    float minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool first = true;
+    int quads = 0;
+    char previous = 0;
+
+    for (const char* c = block.text.data(); block.visible && *c; c++) {
+        if (previous) {
+            penX += atlas.kerning(block.face, previous, *c);
+        }
+        previous = *c;
+
+        const GlyphAtlas::Glyph& g = atlas.glyph(block.face, *c);
+        if (*c != ' ') {
+            float left = penX + g.quad.left;
+            float top = penY + g.quad.top;
+            float right = left + g.quad.width;
+            float bottom = top + g.quad.height;
+            const sf::Vector2f corners[6] = { {left, top}, {right, top}, {right, bottom}, {left, top}, {right, bottom}, {left, bottom} };
+            const sf::Vector2f uvs[6] = {
+                {g.uv.left, g.uv.top}, {g.uv.left + g.uv.width, g.uv.top}, {g.uv.left + g.uv.width, g.uv.top + g.uv.height},
+                {g.uv.left, g.uv.top}, {g.uv.left + g.uv.width, g.uv.top + g.uv.height}, {g.uv.left, g.uv.top + g.uv.height} };
+            for (int i = 0; i < 6; i++) {
+                out[quads * 6 + i] = sf::Vertex(corners[i], block.color, uvs[i]);
+            }
+            quads++;
+
+            if (first) {
+                minX = left; minY = top; maxX = right; maxY = bottom;
+                first = false;
+            }
+            else {
+                minX = std::min(minX, left); minY = std::min(minY, top);
+                maxX = std::max(maxX, right); maxY = std::max(maxY, bottom);
+            }
+        }
+        penX += g.advance;
+    }
+
+    sf::Vector2f offset = block.position;
+    if (block.align == ALIGN_CENTER) {
+        offset.x -= (minX + maxX) / 2.0f;
+        offset.y -= (minY + maxY) / 2.0f;
+    }
+    for (int i = 0; i < quads * 6; i++) {
+        out[i].position = out[i].position + offset;
+    }
+
+    // Unused quads collapse to nothing
+    for (int i = quads * 6; i < block.capacity * 6; i++) {
+        out[i] = sf::Vertex(block.position, sf::Color::Transparent);
+    }
+}
+
+void TextBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const {
+    states.texture = &atlas.texture();
+    target.draw(vertices, states);
+}
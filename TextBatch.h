@@ -0,0 +1,78 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+// A character size and weight the HUD draws text with
+struct FontFace {
+    unsigned characterSize;
+    bool bold;
+};
+
+// Printable ASCII for a handful of font faces, copied out of the font's
+// per-size pages into one texture so all HUD text can share a draw call.
+class GlyphAtlas {
+public:
+    struct Glyph {
+        sf::FloatRect quad;     // relative to the pen position on the baseline
+        sf::FloatRect uv;
+        float advance;
+    };
+
+    static const int firstChar = 32;
+    static const int lastChar = 126;
+
+    void build(const sf::Font& font, const FontFace* faces, int faceCount);
+
+    const sf::Texture& texture() const {
+        return target.getTexture();
+    }
+
+    const Glyph& glyph(int face, char c) const;
+    const FontFace& face(int index) const { return faces[index]; }
+    float kerning(int face, char first, char second) const;
+
+private:
+    const sf::Font* font;
+    std::vector<FontFace> faces;
+    std::vector<Glyph> glyphs;  // (lastChar - firstChar + 1) per face
+    sf::RenderTexture target;
+};
+
+// Fixed text blocks laid out from a GlyphAtlas into one vertex array.
+// A block is only laid out again when its string, colour or visibility
+// changes; every block is drawn together in a single call.
+class TextBatch : public sf::Drawable {
+public:
+    enum Align { ALIGN_TOP_LEFT, ALIGN_CENTER };
+
+    explicit TextBatch(const GlyphAtlas& source);
+
+    // Reserves room for `capacity` characters and returns the block id
+    int addBlock(int face, sf::Color color, sf::Vector2f position, int capacity, Align align = ALIGN_TOP_LEFT);
+
+    void setText(int block, const char* text);
+    void setColor(int block, sf::Color color);
+    void setVisible(int block, bool visible);
+
+protected:
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+
+private:
+    struct Block {
+        int face;
+        sf::Color color;
+        sf::Vector2f position;
+        Align align;
+        int firstVertex;
+        int capacity;
+        bool visible;
+        std::vector<char> text;     // capacity + 1, NUL terminated
+    };
+
+    const GlyphAtlas& atlas;
+    sf::VertexArray vertices;
+    std::vector<Block> blocks;
+
+    void layout(Block& block);
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "GameEngine.h"
+
+// Hands out turns in seat order, jumping straight past the ones players
+// sit out. A seat serving skipTurns is parked on a timing wheel under the
+// round it plays in again, so finding the next turn costs the same however
+// many seats are waiting, and sat-out turns are never stepped one by one.
+//
+// Works on GameState and BitboardState alike. Parked players' skipTurns
+// in the state is only brought up to date when their seat comes round
+// again; call settle() before reading it from outside.
+//
+//     TurnScheduler turns(state);
+//     while (!state.gameOver) {
+//         int player = turns.next(state, maxTurns);
+//         if (player < 0) break;
+//         ...shop if state.players[player].skipTurns == 0...
+//         turns.played(state, player, step(state, Action::move(player)));
+//     }
+//
+// gives the same game as stepping every seat in turn, sat-out turns
+// included.
+
+const int turnWheelRounds = 128;    // more than the longest penalty a rules file allows
+
+static_assert(playerCount <= 32, "seats are kept as bits of a uint32_t");
+
+class TurnScheduler {
+public:
+    template <typename State>
+    explicit TurnScheduler(const State& state) {
+        reset(state);
+    }
+
+    // Turn 0 is seat 0's, and each seat sits out its current skipTurns
+    template <typename State>
+    void reset(const State& state) {
+        nextTurn = 0;
+        currentTurn = -1;
+        for (int r = 0; r < turnWheelRounds; r++) {
+            wheel[r] = 0;
+        }
+        for (int p = 0; p < playerCount; p++) {
+            park(p, p + static_cast<long long>(state.players[p].skipTurns) * playerCount);
+        }
+    }
+
+    // Seat of the next turn that has to be played, or -1 once that turn
+    // would be turnLimit or later. Its skipTurns is brought up to date
+    // first: it is 0 unless a collision is still pending, in which case the
+    // very next turn is played even if it is sat out, so the collision
+    // lands on the same turn as it would without the scheduler.
+    template <typename State>
+    int next(State& state, long long turnLimit) {
+        long long turn;
+        int seat;
+        // Usually the seat next in order simply plays
+        seat = static_cast<int>(nextTurn % playerCount);
+        if (state.pendingPlayers || returnTurn[seat] == nextTurn) {
+            turn = nextTurn;
+        }
+        else {
+            seat = findNext(turn);
+        }
+        if (turn >= turnLimit) {
+            nextTurn = turnLimit;
+            return -1;
+        }
+        currentTurn = turn;
+        unpark(seat);
+        state.players[seat].skipTurns = static_cast<decltype(state.players[seat].skipTurns)>(
+            (returnTurn[seat] - currentTurn) / playerCount);
+        nextTurn = currentTurn + 1;
+        return seat;
+    }
+
+    // Turns gone by, sat-out ones included: one past the last turn next()
+    // handed out, or turnLimit once it has returned -1
+    long long turnsPlayed() const {
+        return nextTurn;
+    }
+
+    // Re-parks `seat` after its move, and anyone its move knocked back
+    template <typename State>
+    void played(const State& state, int seat, const StepResult& result) {
+        park(seat, currentTurn + (static_cast<long long>(state.players[seat].skipTurns) + 1) * playerCount);
+        for (int i = 0; i < result.eventCount; i++) {
+            const GameEvent& e = result.events[i];
+            if (e.type != EVENT_HURDLE_HIT || e.player == seat) continue;
+            // A pending player's penalty starts from their next turn
+            unpark(e.player);
+            long long upcoming = currentTurn + (e.player - seat + playerCount) % playerCount;
+            park(e.player, upcoming + static_cast<long long>(state.players[e.player].skipTurns) * playerCount);
+        }
+    }
+
+    // Writes every parked seat's remaining skipTurns back into the state,
+    // and makes the last turn's seat currentPlayer as stepping it would have
+    template <typename State>
+    void settle(State& state) const {
+        if (nextTurn > 0) {
+            state.currentPlayer = static_cast<decltype(state.currentPlayer)>((nextTurn - 1) % playerCount);
+        }
+        for (int p = 0; p < playerCount; p++) {
+            long long upcoming = nextTurn + ((p - nextTurn) % playerCount + playerCount) % playerCount;
+            long long left = returnTurn[p] > upcoming ? (returnTurn[p] - upcoming) / playerCount : 0;
+            state.players[p].skipTurns = static_cast<decltype(state.players[p].skipTurns)>(left);
+        }
+    }
+
+private:
+    long long nextTurn;                     // first turn not yet handed out
+    long long currentTurn;                  // turn handed out by next()
+    long long returnTurn[playerCount];      // turn each seat plays next
+    uint32_t wheel[turnWheelRounds];        // seats by the round they play next in
+
+    void park(int seat, long long turn) {
+        returnTurn[seat] = turn;
+        wheel[turn / playerCount % turnWheelRounds] |= uint32_t(1) << seat;
+    }
+
+    void unpark(int seat) {
+        wheel[returnTurn[seat] / playerCount % turnWheelRounds] &= ~(uint32_t(1) << seat);
+    }
+
+    // Seat and turn of the earliest parked turn at or after nextTurn
+    int findNext(long long& turn) const {
+        long long round = nextTurn / playerCount;
+        int from = static_cast<int>(nextTurn % playerCount);
+        for (;; round++, from = 0) {
+            uint32_t seats = wheel[round % turnWheelRounds] >> from;
+            for (int seat = from; seats; seat++, seats >>= 1) {
+                // The wheel wraps, so a bucket can also hold later rounds
+                if ((seats & 1) && returnTurn[seat] == round * playerCount + seat) {
+                    turn = returnTurn[seat];
+                    return seat;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,58 @@
+#include "Undo.h"
+
+UndoHistory::UndoHistory(int capacity) : ring(capacity > 0 ? capacity + 1 : 2), first(0), count(0), cursor(0) {}
+
+const Snapshot& UndoHistory::at(int position) const {
+    int index = first + position;
+    return ring[index < static_cast<int>(ring.size()) ? index : index - ring.size()];
+}
+
+Snapshot& UndoHistory::at(int position) {
+    int index = first + position;
+    return ring[index < static_cast<int>(ring.size()) ? index : index - ring.size()];
+}
+
+void UndoHistory::reset(const GameState& state) {
+    first = 0;
+    count = 1;
+    cursor = 0;
+    packSnapshot(state, ring[0]);
+}
+
+void UndoHistory::record(const GameState& state) {
+    if (count == 0) {
+        reset(state);
+        return;
+    }
+
+    // Anything that could have been redone is gone now
+    count = cursor + 1;
+    if (count == static_cast<int>(ring.size())) {
+        first = first + 1 < static_cast<int>(ring.size()) ? first + 1 : 0;
+        count--;
+        cursor--;
+    }
+    cursor++;
+    count++;
+    packSnapshot(state, at(cursor));
+}
+
+bool UndoHistory::undo(GameState& state) {
+    if (cursor == 0) return false;
+    cursor--;
+    unpackSnapshot(at(cursor), state);
+    return true;
+}
+
+bool UndoHistory::redo(GameState& state) {
+    if (cursor + 1 >= count) return false;
+    cursor++;
+    unpackSnapshot(at(cursor), state);
+    return true;
+}
+
+void UndoHistory::rollback(GameState& state) const {
+    if (count > 0) {
+        unpackSnapshot(at(cursor), state);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "GameEngine.h"
+#include "Snapshot.h"
+
+#include <vector>
+
+// Undo and redo over the positions of a match. Every position is kept as
+// a Snapshot (96 bytes for two players on 5x5) in a ring that is sized
+// once, so 128 steps cost about 12 KB. Recording, undoing and redoing
+// each pack or unpack one snapshot and never touch the heap; the oldest
+// positions are dropped once the ring is full.
+//
+// The history is a line of positions with the current one somewhere on
+// it. Undo and redo move along the line; recording a new position cuts
+// off everything after the current one, as editors do.
+class UndoHistory {
+public:
+    static const int defaultCapacity = 128;
+
+    // Holds `capacity` steps besides the current position
+    explicit UndoHistory(int capacity = defaultCapacity);
+
+    // Forgets every step and starts over from `state`
+    void reset(const GameState& state);
+
+    // Adds `state` as the position after the current one
+    void record(const GameState& state);
+
+    // Steps back or forward, writing that position to `state`. Returns
+    // false, leaving `state` alone, when there is nothing to go back or
+    // forward to.
+    bool undo(GameState& state);
+    bool redo(GameState& state);
+
+    // Puts `state` back to the current position, discarding whatever was
+    // done to it since the last record(); how previews are taken back
+    void rollback(GameState& state) const;
+
+    int undoSteps() const {
+        return cursor;
+    }
+
+    int redoSteps() const {
+        return count > 0 ? count - 1 - cursor : 0;
+    }
+
+    int capacity() const {
+        return static_cast<int>(ring.size()) - 1;
+    }
+
+private:
+    std::vector<Snapshot> ring;
+    int first;      // ring index of the oldest position
+    int count;      // positions held, the current one included
+    int cursor;     // the current position, counted from the oldest
+
+    const Snapshot& at(int position) const;
+    Snapshot& at(int position);
+};